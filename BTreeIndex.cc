@@ -1,270 +1,1331 @@
-/*
- * Copyright (C) 2008 by The Regents of the University of California
- * Redistribution of this file is permitted under the terms of the GNU
- * Public License (GPL).
- *
- * @author Junghoo "John" Cho <cho AT cs.ucla.edu>
- * @date 3/24/2008
- */
- 
-#include "BTreeIndex.h"
-#include "BTreeNode.h"
-#include <string.h>
-#include <cstdio>
-
-using namespace std;
-
-#define DEBUG 0
-
-/*
- * BTreeIndex constructor
- */
-BTreeIndex::BTreeIndex()
-{
-    rootPid = -1;
-	treeHeight = 0;
-	not_read = true;
-}
-
-/*
- * Open the index file in read or write mode.
- * Under 'w' mode, the index file should be created if it does not exist.
- * @param indexname[IN] the name of the index file
- * @param mode[IN] 'r' for read, 'w' for write
- * @return error code. 0 if no error
- */
-RC BTreeIndex::open(const string& indexname, char mode)
-{
-	RC rc;
-	if ((rc = pf.open(indexname, mode))< 0)return rc;
-	char buffer[PageFile::PAGE_SIZE];
-	if(pf.endPid() == 0)
-	{
-		memset(buffer, 0, sizeof(buffer));
-		PageId root = -1;
-		memcpy(buffer, &root, sizeof(PageId));
-		int height = 0;
-		memcpy(buffer+sizeof(PageId),&height, sizeof(int));
-		pf.write(0, buffer);
-	}
-	if(mode == 'r' && not_read)
-	{
-		memset(buffer, 0, sizeof(buffer));
-		pf.read(0, buffer);
-		PageId pid;
-		int height;
-		memcpy(&pid, buffer, sizeof(PageId));
-		memcpy(&height, buffer + sizeof(PageId), sizeof(int));
-		rootPid = pid;
-		treeHeight = height;
-		not_read = false;
-	}
-	return 0;
-}
-
-/*
- * Close the index file.
- * @return error code. 0 if no error
- */
-RC BTreeIndex::close()
-{
-	char buffer[PageFile::PAGE_SIZE];
-	memcpy(buffer, &rootPid, sizeof(PageId));
-	memcpy(buffer+sizeof(PageId),&treeHeight, sizeof(int));
-	pf.write(0, buffer);
-	return pf.close();
-}
-
-/*
- * Insert (key, RecordId) pair to the index.
- * @param key[IN] the key for the value inserted into the index
- * @param rid[IN] the RecordId for the record being inserted into the index
- * @return error code. 0 if no error
- */
-RC BTreeIndex::insert(int key, const RecordId& rid)
-{
-#if DEBUG
-	 fprintf(stdout, "Inserting key: %i, current tree height is %i\n", key, treeHeight);
-#endif
-
-	BTLeafNode l;
-	PageId pid;
-	IndexCursor ic;
-
-	if (rootPid != -1)
-	{
-	    locate(key, ic);//this also sets the path variable
-	    pid = ic.pid;
-	    l.read(pid, pf);
-	}
-	else
-	{
-		pid = pf.endPid();
-		rootPid = pid;
-		treeHeight = 1;
-	}
-	if(l.getKeyCount() < MAX_NODE_SIZE)
-	{
-		l.insert(key, rid);
-		l.write(pid, pf);
-	}
-	else
-	{
-		BTLeafNode sibling;
-		int sibkey;
-		l.insertAndSplit(key,rid, sibling, sibkey);
-		sibling.setNextNodePtr(l.getNextNodePtr());
-		PageId sib_pid = pf.endPid();
-		sibling.write(sib_pid, pf);
-		l.setNextNodePtr(sib_pid);
-		l.write(pid, pf);
-		insert_into_parent(treeHeight-2, pid, sibkey, sib_pid);
-	}
-    return 0;
-}
-
-RC BTreeIndex::insert_into_parent(int level, PageId childpid, int key, PageId sib_pid)
-{
-	if(level == -1)
-	{
-		BTNonLeafNode root;
-		root.initializeRoot(childpid,  key,  sib_pid);
-		PageId r = pf.endPid();
-		root.write(r, pf);
-		rootPid = r;
-		treeHeight++;
-		return 0;
-	}
-	BTNonLeafNode parent;
-	parent.read(path[level], pf);
-	if(parent.getKeyCount() < MAX_NODE_SIZE)
-	{
-		//inser
-		parent.insert(key, sib_pid);
-		parent.write(path[level], pf);
-	}
-	else
-	{
-		BTNonLeafNode sibling;
-		int midkey;
-		PageId psibling_pid = pf.endPid();
-		parent.insertAndSplit(key, sib_pid, sibling, midkey);
-		sibling.write(psibling_pid, pf);
-		parent.write(path[level], pf);
-		insert_into_parent(level-1, path[level], midkey, psibling_pid);
-	}
-	return 0;
-	
-}
-
-
-/**
- * Run the standard B+Tree key search algorithm and identify the
- * leaf node where searchKey may exist. If an index entry with
- * searchKey exists in the leaf node, set IndexCursor to its location
- * (i.e., IndexCursor.pid = PageId of the leaf node, and
- * IndexCursor.eid = the searchKey index entry number.) and return 0.
- * If not, set IndexCursor.pid = PageId of the leaf node and
- * IndexCursor.eid = the index entry immediately after the largest
- * index key that is smaller than searchKey, and return the error
- * code RC_NO_SUCH_RECORD.
- * Using the returned "IndexCursor", you will have to call readForward()
- * to retrieve the actual (key, rid) pair from the index.
- * @param key[IN] the key to find
- * @param cursor[OUT] the cursor pointing to the index entry with
- *                    searchKey or immediately behind the largest key
- *                    smaller than searchKey.
- * @return 0 if searchKey is found. Othewise an error code
- */
-RC BTreeIndex::locate(int searchKey, IndexCursor& cursor)
-{
-	if(rootPid == -1)
-		return RC_NO_SUCH_RECORD;
-	int level = 0;
-	PageId pid;
-	if(treeHeight > 1)
-	{
-		BTNonLeafNode n;
-		n.read(rootPid, pf);
-		path[0] = rootPid;
-		while(level < treeHeight)
-		{
-			level++;
-			if(level == treeHeight)
-				break; 
-			n.locateChildPtr(searchKey, pid);
-			path[level] = pid;
-			n.read(pid, pf);
-		}
-	}
-	else
-	{
-		pid = rootPid;
-	}
-	//found the leaf node
-	BTLeafNode l;
-	l.read(pid,pf);
-	int eid;
-	RC rc;
-	rc = l.locate(searchKey, eid);
-	cursor.eid = eid;
-	cursor.pid = pid;
-	if(rc == RC_NO_SUCH_RECORD)
-		return RC_NO_SUCH_RECORD;
-
-    return 0;
-}
-
-/*
- * Read the (key, rid) pair at the location specified by the index cursor,
- * and move foward the cursor to the next entry.
- * @param cursor[IN/OUT] the cursor pointing to an leaf-node index entry in the b+tree
- * @param key[OUT] the key stored at the index cursor location.
- * @param rid[OUT] the RecordId stored at the index cursor location.
- * @return error code. 0 if no error
- */
-RC BTreeIndex::readForward(IndexCursor& cursor, int& key, RecordId& rid)
-{
-    BTLeafNode l;
-	l.read(cursor.pid, pf);
-	RC code = l.readEntry(cursor.eid, key, rid);
-	
-	if(cursor.eid == l.getKeyCount()-1)//last entry in current leaf, move to next node.. what if there is no next node ? what to set indexcursor to ?
-	{
-		cursor.eid = 0;
-		cursor.pid = l.getNextNodePtr();
-	}
-	else
-		cursor.eid+=1;
-
-	return code;
-}
-
-RC BTreeIndex::printTree()
-{
-	printTree(rootPid, treeHeight, 1, 10000);
-	return 0;
-}
-
-RC BTreeIndex::printTree(PageId root, int height, int start, int end)
-{
-#if DEBUG
-	if (!height)return 0;
-
-	BTLeafNode leaf;
-	int rc;
-	RecordId rid;
-	int key, readKey;
-	IndexCursor ic;
-
-	for (int key=start; key<end; key++){
-		rc = locate(key, ic);
-		if (rc){
-			fprintf(stdout, "key: %i not found\n", key);
-		}
-		rc = readForward(ic, readKey, rid);
-		fprintf(stdout, "key: %i readKey:%i rid pid:%i sid:%i\n", key, readKey, rid.pid, rid.sid);
-	}
-#endif
-	return 0;
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ *
+ * @author Junghoo "John" Cho <cho AT cs.ucla.edu>
+ * @date 3/24/2008
+ */
+ 
+#include "BTreeIndex.h"
+#include "BTreeNode.h"
+#include <string.h>
+#include <cstdio>
+#include <algorithm>
+#include <climits>
+
+using namespace std;
+
+#define DEBUG 0
+
+// the largest error (in leaf nodes) of the leaf predicted by the learned model
+static const int MODEL_MAX_ERROR = 1;
+
+// the size of a model segment on disk: key, pid, # leaf nodes and slope
+static const int SEGMENT_SIZE = sizeof(int) + sizeof(PageId) + sizeof(int) + sizeof(double);
+
+// The header page of the index.
+// ------------------------------------------------------------------------------------
+// |--rootPid--|--treeHeight--|--modelPid--|--# segments--|--# entries--|--min key--|--max key--|
+// ------------------------------------------------------------------------------------
+static const int HEADER_ENTRIES = 2 * sizeof(PageId) + 2 * sizeof(int);
+
+/*
+ * BTreeIndex constructor
+ */
+BTreeIndex::BTreeIndex()
+{
+    rootPid = -1;
+	treeHeight = 0;
+	not_read = true;
+	leafPid = -1;
+	overflowPid = -1;
+	modelPid = -1;
+	entryCount = 0;
+	minKey = maxKey = 0;
+}
+
+/*
+ * Open the index file in read or write mode.
+ * Under 'w' mode, the index file should be created if it does not exist.
+ * @param indexname[IN] the name of the index file
+ * @param mode[IN] 'r' for read, 'w' for write
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::open(const string& indexname, char mode)
+{
+	RC rc;
+	if ((rc = pf.open(indexname, mode))< 0)return rc;
+	leafPid = overflowPid = -1;
+	char buffer[PageFile::PAGE_SIZE];
+	if(pf.endPid() == 0)
+	{
+		memset(buffer, 0, sizeof(buffer));
+		PageId root = -1;
+		memcpy(buffer, &root, sizeof(PageId));
+		int height = 0;
+		memcpy(buffer+sizeof(PageId),&height, sizeof(int));
+		memcpy(buffer+sizeof(PageId)+sizeof(int), &root, sizeof(PageId));
+		pf.write(0, buffer);
+	}
+	// read the root and the height back in both modes, so that an existing
+	// index opened in 'w' mode keeps growing instead of being overwritten
+	if(not_read)
+	{
+		memset(buffer, 0, sizeof(buffer));
+		pf.read(0, buffer);
+		PageId pid;
+		int height;
+		memcpy(&pid, buffer, sizeof(PageId));
+		memcpy(&height, buffer + sizeof(PageId), sizeof(int));
+		rootPid = pid;
+		treeHeight = height;
+		not_read = false;
+
+		// load the learned model of the leaf level, if there is one
+		int count;
+		memcpy(&modelPid, buffer + sizeof(PageId) + sizeof(int), sizeof(PageId));
+		memcpy(&count, buffer + sizeof(PageId) + sizeof(int) + sizeof(PageId), sizeof(int));
+		if (modelPid != -1 && (rc = readModel(count)) < 0)
+			return rc;
+
+		// an index written before the entries were counted has a root
+		// but no entries in its header
+		memcpy(&entryCount, buffer + HEADER_ENTRIES, sizeof(int));
+		memcpy(&minKey, buffer + HEADER_ENTRIES + sizeof(int), sizeof(int));
+		memcpy(&maxKey, buffer + HEADER_ENTRIES + 2 * sizeof(int), sizeof(int));
+		if (rootPid != -1 && entryCount == 0)
+			entryCount = -1;
+	}
+	return 0;
+}
+
+/*
+ * Close the index file.
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::close()
+{
+	char buffer[PageFile::PAGE_SIZE];
+	int count = segments.size();
+	memset(buffer, 0, sizeof(buffer));
+	memcpy(buffer, &rootPid, sizeof(PageId));
+	memcpy(buffer+sizeof(PageId),&treeHeight, sizeof(int));
+	memcpy(buffer+sizeof(PageId)+sizeof(int), &modelPid, sizeof(PageId));
+	memcpy(buffer+sizeof(PageId)+sizeof(int)+sizeof(PageId), &count, sizeof(int));
+	memcpy(buffer+HEADER_ENTRIES, &entryCount, sizeof(int));
+	memcpy(buffer+HEADER_ENTRIES+sizeof(int), &minKey, sizeof(int));
+	memcpy(buffer+HEADER_ENTRIES+2*sizeof(int), &maxKey, sizeof(int));
+	pf.write(0, buffer);
+	leafPid = overflowPid = -1;
+	return pf.close();
+}
+
+/*
+ * Insert (key, RecordId) pair to the index.
+ * @param key[IN] the key for the value inserted into the index
+ * @param rid[IN] the RecordId for the record being inserted into the index
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::insert(int key, const RecordId& rid)
+{
+#if DEBUG
+	 fprintf(stdout, "Inserting key: %i, current tree height is %i\n", key, treeHeight);
+#endif
+
+	BTLeafNode l;
+	PageId pid;
+	IndexCursor ic;
+
+	// the model does not know about the new entry. it is dropped first,
+	// as the descent below must set path for insert_into_parent()
+	dropModel();
+
+	if (rootPid != -1)
+	{
+	    locate(key, ic);//this also sets the path variable
+	    pid = ic.pid;
+	    l.read(pid, pf);
+	}
+	else
+	{
+		pid = pf.endPid();
+		rootPid = pid;
+		treeHeight = 1;
+	}
+
+	RC rc;
+	int eid;
+	int runKey;
+	RecordId runRid;
+	int run = 0;
+	if (l.locate(key, eid) == 0)
+		while (l.readEntry(eid+run, runKey, runRid) == 0 && runKey == key)
+			run++;
+
+	// the run is long. the new entry goes to its overflow pages
+	LeafEntries entry(1, make_pair(key, rid));
+	PageId head = -1;
+	if (run >= MAX_INLINE_RIDS && (head = l.getOverflowPtr(eid)) != -1)
+	{
+		rc = insertOverflow(head, entry, 0, 1);
+	}
+	else if (run >= MAX_INLINE_RIDS && l.setOverflowPtr(eid, pf.endPid()) == 0)
+	{
+		// the first overflow page of the run is created at pf.endPid()
+		if ((rc = insertOverflow(head, entry, 0, 1)) == 0)
+			rc = l.write(pid, pf);
+	}
+	else if (l.insert(key, rid) == 0)
+	{
+		rc = l.write(pid, pf);
+	}
+	else
+	{
+		// also reached when the overflow pointer of a long run does not fit
+		// in the node. the entry stays inline and the node is split
+		BTLeafNode sibling;
+		int sibkey;
+		if ((rc = l.insertAndSplit(key,rid, sibling, sibkey)) == 0)
+		{
+			sibling.setNextNodePtr(l.getNextNodePtr());
+			sibling.setPrevNodePtr(pid);
+			PageId sib_pid = pf.endPid();
+			sibling.write(sib_pid, pf);
+			l.setNextNodePtr(sib_pid);
+			l.write(pid, pf);
+			if (sibling.getNextNodePtr() != -1)
+				setPrevPtr(sibling.getNextNodePtr(), sib_pid);
+			insert_into_parent(treeHeight-2, pid, sibkey, sib_pid);
+		}
+	}
+
+	// the nodes read by locate() may have changed
+	leafPid = overflowPid = -1;
+	countEntries(key, key, 1, rc);
+	return rc;
+}
+
+/*
+ * Insert a batch of (key, RecordId) pairs to the index.
+ * @param entries[IN/OUT] the (key, RecordId) pairs to insert.
+ *                        The vector is sorted by this function.
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::insertBatch(vector<pair<int, RecordId> >& entries)
+{
+	RC rc;
+	if (entries.empty())
+		return 0;
+	sort(entries.begin(), entries.end());
+	dropModel();
+
+	if (rootPid == -1)
+	{
+		// start from an empty leaf as the root
+		BTLeafNode l;
+		rootPid = pf.endPid();
+		treeHeight = 1;
+		if ((rc = l.write(rootPid, pf)) < 0)
+		{
+			countEntries(0, 0, 0, rc);
+			return rc;
+		}
+	}
+
+	Siblings siblings;
+	rc = insertBatch(rootPid, treeHeight, entries, 0, entries.size(), siblings);
+	leafPid = overflowPid = -1;
+	if (rc < 0)
+	{
+		countEntries(0, 0, 0, rc);
+		return rc;
+	}
+
+	// the root was split. add new levels on top until a single root is left
+	while (!siblings.empty())
+	{
+		vector<int> keys;
+		vector<PageId> children;
+		children.push_back(rootPid);
+		for (unsigned i = 0; i < siblings.size(); i++)
+		{
+			keys.push_back(siblings[i].first);
+			children.push_back(siblings[i].second);
+		}
+		siblings.clear();
+
+		PageId newRoot = pf.endPid();
+		if ((rc = writeNonLeafNodes(-1, keys, children, siblings)) < 0)
+		{
+			countEntries(0, 0, 0, rc);
+			return rc;
+		}
+		rootPid = newRoot;
+		treeHeight++;
+	}
+	countEntries(entries.front().first, entries.back().first, entries.size(), 0);
+	return 0;
+}
+
+/*
+ * Count new entries with keys in [lower, upper] in the header, once
+ * they have been inserted. After a failed insert, the tree may hold some
+ * of the entries, and the count is no longer known.
+ */
+void BTreeIndex::countEntries(int lower, int upper, int count, RC rc)
+{
+	if (rc < 0)
+		entryCount = -1;
+	if (entryCount < 0)
+		return;
+	if (entryCount == 0 || lower < minKey)
+		minKey = lower;
+	if (entryCount == 0 || upper > maxKey)
+		maxKey = upper;
+	entryCount += count;
+}
+
+/*
+ * Get the smallest and the largest key in the index from the header.
+ * @param min[OUT] the smallest key
+ * @param max[OUT] the largest key
+ * @return 0 if the keys are known, RC_END_OF_TREE if the index is empty,
+ *         RC_NO_SUCH_RECORD if the index does not count its entries
+ */
+RC BTreeIndex::getKeyRange(int& min, int& max) const
+{
+	if (entryCount < 0)
+		return RC_NO_SUCH_RECORD;
+	if (entryCount == 0)
+		return RC_END_OF_TREE;
+	min = minKey;
+	max = maxKey;
+	return 0;
+}
+
+/*
+ * Insert entries[begin, end) into the subtree rooted at pid.
+ * The new nodes created by splitting pid are returned in siblings
+ * as (separator key, PageId) pairs, to be added to the parent of pid.
+ */
+RC BTreeIndex::insertBatch(PageId pid, int height, const LeafEntries& entries,
+                           int begin, int end, Siblings& siblings)
+{
+	RC rc;
+	if (height == 1)
+	{
+		BTLeafNode l;
+		if ((rc = l.read(pid, pf)) < 0)
+			return rc;
+
+		// merge the old entries of the leaf with the new ones in one pass
+		LeafEntries merged;
+		vector<PageId> overflows;
+		merged.reserve(l.getKeyCount() + end - begin);
+		int key;
+		RecordId rid;
+		int eid = 0;
+		int i = begin;
+		bool more = (l.readEntry(eid, key, rid) == 0);
+		while (more || i < end)
+		{
+			if (more && (i == end || key <= entries[i].first))
+			{
+				merged.push_back(make_pair(key, rid));
+				overflows.push_back(l.getOverflowPtr(eid));
+				more = (l.readEntry(++eid, key, rid) == 0);
+			}
+			else
+			{
+				// a new entry of an old run shares the overflow pages of the run
+				PageId head = -1;
+				if (!merged.empty() && merged.back().first == entries[i].first)
+					head = overflows.back();
+				merged.push_back(entries[i++]);
+				overflows.push_back(head);
+			}
+		}
+
+		// move the entries of long runs beyond MAX_INLINE_RIDS to overflow pages
+		LeafEntries inlined;
+		vector<PageId> heads;
+		inlined.reserve(merged.size());
+		heads.reserve(merged.size());
+		int total = merged.size();
+		for (int first = 0, last; first < total; first = last)
+		{
+			last = first + 1;
+			while (last < total && merged[last].first == merged[first].first)
+				last++;
+
+			PageId head = overflows[first];
+			int split = last;
+			if (last - first > MAX_INLINE_RIDS)
+			{
+				split = first + MAX_INLINE_RIDS;
+				if ((rc = insertOverflow(head, merged, split, last)) < 0)
+					return rc;
+			}
+			for (int k = first; k < split; k++)
+			{
+				inlined.push_back(merged[k]);
+				heads.push_back(head);
+			}
+		}
+		return writeLeafNodes(pid, l.getPrevNodePtr(), l.getNextNodePtr(),
+		                      inlined, heads, siblings);
+	}
+
+	BTNonLeafNode n;
+	if ((rc = n.read(pid, pf)) < 0)
+		return rc;
+
+	// route the new entries to the children. locateChildPtr() follows the
+	// right pointer of a key equal to searchKey, so the child in front of
+	// a separator receives the keys smaller than the separator.
+	vector<int> keys;
+	vector<PageId> children;
+	children.push_back(n.getFirstChildPtr());
+	bool changed = false;
+	int count = n.getKeyCount();
+	int i = begin;
+	for (int eid = 0; eid <= count; eid++)
+	{
+		bool last = (eid == count);
+		int sepKey = 0;
+		PageId nextPid = -1;
+		if (!last)
+			n.readEntry(eid, sepKey, nextPid);
+
+		int j = i;
+		while (j < end && (last || entries[j].first < sepKey))
+			j++;
+		if (j > i)
+		{
+			Siblings childSiblings;
+			if ((rc = insertBatch(children.back(), height-1, entries, i, j, childSiblings)) < 0)
+				return rc;
+			for (unsigned k = 0; k < childSiblings.size(); k++)
+			{
+				keys.push_back(childSiblings[k].first);
+				children.push_back(childSiblings[k].second);
+			}
+			changed = changed || !childSiblings.empty();
+			i = j;
+		}
+
+		if (!last)
+		{
+			keys.push_back(sepKey);
+			children.push_back(nextPid);
+		}
+	}
+
+	// none of the children was split. the node does not change
+	if (!changed)
+		return 0;
+	return writeNonLeafNodes(pid, keys, children, siblings);
+}
+
+/*
+ * Write the sorted entries as a chain of leaf nodes. overflows[i] is the
+ * first overflow page of the run of entries[i]. The runs are spread evenly
+ * over as few nodes as they fit in. The first node is written to pid, and
+ * the rest to new pages at the end of the file. The first node points back
+ * to prevPid and the last node points to nextPid (and nextPid back to it).
+ * The new nodes are returned in siblings.
+ */
+RC BTreeIndex::writeLeafNodes(PageId pid, PageId prevPid, PageId nextPid,
+                              const LeafEntries& entries,
+                              const vector<PageId>& overflows, Siblings& siblings)
+{
+	RC rc;
+	int total = entries.size();
+
+	// runs[r] is the first entry of run r
+	vector<int> runs;
+	for (int i = 0; i < total; i++)
+		if (i == 0 || entries[i].first != entries[i-1].first)
+			runs.push_back(i);
+	runs.push_back(total);
+	int runCount = runs.size() - 1;
+
+	// count the nodes needed when each node is filled up
+	int nodes = 1;
+	BTLeafNode l;
+	for (int r = 0; r < runCount; r++)
+	{
+		if (fillLeafNode(l, entries, overflows, runs[r], runs[r+1]) == 0)
+			continue;
+		l = BTLeafNode();
+		nodes++;
+		if ((rc = fillLeafNode(l, entries, overflows, runs[r], runs[r+1])) < 0)
+			return rc;
+	}
+
+	// spread the entries evenly over the nodes. the runs do not all take
+	// the same bytes, so one more node may be needed
+	for (;; nodes++)
+	{
+		vector<BTLeafNode> built(nodes);
+		vector<int> firstRuns(nodes, runCount);
+		int r = 0;
+		int n;
+		for (n = 0; n < nodes; n++)
+		{
+			firstRuns[n] = r;
+			int target = runs[r] + (total - runs[r]) / (nodes - n);
+			int end = (n == nodes-1) ? runCount : r + 1;
+			while (end < runCount && runs[end] < target)
+				end++;
+			for (; r < end; r++)
+				if (fillLeafNode(built[n], entries, overflows, runs[r], runs[r+1]) < 0)
+					break;
+			if (r < end)
+				break;
+		}
+		if (n < nodes)
+			continue;
+
+		// the new nodes take consecutive pages, so the next pointers are
+		// known before the nodes are written
+		PageId newPid = pf.endPid();
+		PageId curPid = prevPid;
+		for (n = 0; n < nodes; n++)
+		{
+			built[n].setPrevNodePtr(curPid);
+			curPid = (n == 0) ? pid : newPid + n - 1;
+			built[n].setNextNodePtr((n == nodes-1) ? nextPid : newPid + n);
+			if ((rc = built[n].write(curPid, pf)) < 0)
+				return rc;
+			if (n > 0)
+				siblings.push_back(make_pair(entries[runs[firstRuns[n]]].first, curPid));
+		}
+		if (nodes > 1 && nextPid != -1)
+			return setPrevPtr(nextPid, curPid);
+		return 0;
+	}
+}
+
+/*
+ * Set the previous sibling pointer of the leaf node pid to prevPid.
+ */
+RC BTreeIndex::setPrevPtr(PageId pid, PageId prevPid)
+{
+	RC rc;
+	BTLeafNode l;
+	if ((rc = l.read(pid, pf)) < 0)
+		return rc;
+	l.setPrevNodePtr(prevPid);
+	return l.write(pid, pf);
+}
+
+/*
+ * Add the run entries[begin, end) with the overflow pages overflows[begin]
+ * to the leaf node l. If the run does not fit, l is left unchanged and
+ * RC_NODE_FULL is returned.
+ */
+RC BTreeIndex::fillLeafNode(BTLeafNode& l, const LeafEntries& entries,
+                            const vector<PageId>& overflows, int begin, int end)
+{
+	RC rc = 0;
+
+	// a single entry is taken out by insert() itself when it does not
+	// fit. a longer run needs a copy of the node to go back to.
+	bool single = (end - begin == 1 && overflows[begin] == -1);
+	BTLeafNode backup;
+	if (!single)
+		backup = l;
+
+	for (int i = begin; i < end && rc == 0; i++)
+		rc = l.insert(entries[i].first, entries[i].second);
+	if (rc == 0 && overflows[begin] != -1)
+		rc = l.setOverflowPtr(l.getKeyCount()-1, overflows[begin]);
+	if (rc < 0 && !single)
+		l = backup;
+	return rc;
+}
+
+/*
+ * Append entries[begin, end) to the overflow pages of a run. head is the
+ * first overflow page of the run, or -1 if the run has none yet, in which
+ * case it is set to the new first page (created at pf.endPid()).
+ * The head page and the page behind it are filled first. New pages are
+ * linked right behind the head page, so that head never changes and the
+ * page with room is found in two reads.
+ */
+RC BTreeIndex::insertOverflow(PageId& head, const LeafEntries& entries, int begin, int end)
+{
+	RC rc;
+	BTOverflowNode h;
+	if (head == -1)
+	{
+		head = pf.endPid();
+		if ((rc = h.write(head, pf)) < 0)
+			return rc;
+	}
+	else if ((rc = h.read(head, pf)) < 0)
+		return rc;
+
+	int i = begin;
+	while (i < end && h.insert(entries[i].second) == 0)
+		i++;
+
+	// the second page is the most recently created one
+	PageId secondPid = h.getNextNodePtr();
+	if (i < end && secondPid != -1)
+	{
+		BTOverflowNode o;
+		if ((rc = o.read(secondPid, pf)) < 0)
+			return rc;
+		int start = i;
+		while (i < end && o.insert(entries[i].second) == 0)
+			i++;
+		if (i > start && (rc = o.write(secondPid, pf)) < 0)
+			return rc;
+	}
+
+	while (i < end)
+	{
+		BTOverflowNode o;
+		while (i < end && o.insert(entries[i].second) == 0)
+			i++;
+		o.setNextNodePtr(h.getNextNodePtr());
+		PageId opid = pf.endPid();
+		if ((rc = o.write(opid, pf)) < 0)
+			return rc;
+		h.setNextNodePtr(opid);
+	}
+	return h.write(head, pf);
+}
+
+/*
+ * Append the RecordIds in the overflow pages starting at head to entries.
+ */
+RC BTreeIndex::readOverflow(PageId head, int key, LeafEntries& entries)
+{
+	RC rc;
+	BTOverflowNode o;
+	RecordId rid;
+	for (PageId opid = head; opid != -1; opid = o.getNextNodePtr())
+	{
+		if ((rc = o.read(opid, pf)) < 0)
+			return rc;
+		for (int i = 0; o.readEntry(i, rid) == 0; i++)
+			entries.push_back(make_pair(key, rid));
+	}
+	return 0;
+}
+
+/*
+ * Write the children and the keys between them as non-leaf nodes.
+ * keys[i] is the separator between children[i] and children[i+1].
+ * The first node is written to pid (or to a new page if pid is -1), and
+ * the rest to new pages at the end of the file. The key between two
+ * nodes is pushed up and returned with the new node in siblings.
+ */
+RC BTreeIndex::writeNonLeafNodes(PageId pid, const vector<int>& keys,
+                                 const vector<PageId>& children, Siblings& siblings)
+{
+	RC rc;
+	int total = children.size();
+
+	// count the nodes needed when each node is filled up
+	int nodes = 0;
+	for (int begin = 0; begin < total; nodes++)
+	{
+		BTNonLeafNode node;
+		int end = begin + 2;
+		node.initializeRoot(children[begin], keys[begin], children[begin+1]);
+		while (end < total && node.append(keys[end-1], children[end]) == 0)
+			end++;
+		begin = end;
+		// a node needs at least two children
+		if (total - begin == 1)
+			begin--;
+	}
+
+	// spread the children evenly over the nodes. the entries do not all
+	// take the same bytes, so one more node may be needed
+	for (;; nodes++)
+	{
+		vector<BTNonLeafNode> built(nodes);
+		int begin = 0;
+		int n;
+		for (n = 0; n < nodes; n++)
+		{
+			int end = begin + (total - begin) / (nodes - n);
+			BTNonLeafNode& node = built[n];
+			node.initializeRoot(children[begin], keys[begin], children[begin+1]);
+			int i;
+			for (i = begin+1; i < end-1; i++)
+				if (node.append(keys[i], children[i+1]) < 0)
+					break;
+			if (i < end-1)
+				break;
+			begin = end;
+		}
+		if (n < nodes)
+			continue;
+
+		PageId newPid = pf.endPid();
+		begin = 0;
+		for (n = 0; n < nodes; n++)
+		{
+			int end = begin + (total - begin) / (nodes - n);
+			PageId curPid = (n == 0 && pid != -1) ? pid : newPid++;
+			if ((rc = built[n].write(curPid, pf)) < 0)
+				return rc;
+			if (n > 0)
+				siblings.push_back(make_pair(keys[begin-1], curPid));
+			begin = end;
+		}
+		return 0;
+	}
+}
+
+RC BTreeIndex::insert_into_parent(int level, PageId childpid, int key, PageId sib_pid)
+{
+	if(level == -1)
+	{
+		BTNonLeafNode root;
+		root.initializeRoot(childpid,  key,  sib_pid);
+		PageId r = pf.endPid();
+		root.write(r, pf);
+		rootPid = r;
+		treeHeight++;
+		return 0;
+	}
+	BTNonLeafNode parent;
+	parent.read(path[level], pf);
+	if(parent.insert(key, sib_pid) == 0)
+	{
+		parent.write(path[level], pf);
+	}
+	else
+	{
+		BTNonLeafNode sibling;
+		int midkey;
+		PageId psibling_pid = pf.endPid();
+		parent.insertAndSplit(key, sib_pid, sibling, midkey);
+		sibling.write(psibling_pid, pf);
+		parent.write(path[level], pf);
+		insert_into_parent(level-1, path[level], midkey, psibling_pid);
+	}
+	return 0;
+	
+}
+
+
+/**
+ * Run the standard B+Tree key search algorithm and identify the
+ * leaf node where searchKey may exist. If an index entry with
+ * searchKey exists in the leaf node, set IndexCursor to its location
+ * (i.e., IndexCursor.pid = PageId of the leaf node, and
+ * IndexCursor.eid = the searchKey index entry number.) and return 0.
+ * If not, set IndexCursor.pid = PageId of the leaf node and
+ * IndexCursor.eid = the index entry immediately after the largest
+ * index key that is smaller than searchKey, and return the error
+ * code RC_NO_SUCH_RECORD.
+ * Using the returned "IndexCursor", you will have to call readForward()
+ * to retrieve the actual (key, rid) pair from the index.
+ * @param key[IN] the key to find
+ * @param cursor[OUT] the cursor pointing to the index entry with
+ *                    searchKey or immediately behind the largest key
+ *                    smaller than searchKey.
+ * @return 0 if searchKey is found. Othewise an error code
+ */
+RC BTreeIndex::locate(int searchKey, IndexCursor& cursor)
+{
+	if(rootPid == -1)
+		return RC_NO_SUCH_RECORD;
+	PageId pid;
+	locateLeaf(searchKey, pid);
+
+	//found the leaf node
+	int eid;
+	RC rc;
+	if ((rc = readLeaf(pid)) < 0)
+		return rc;
+	rc = leaf.locate(searchKey, eid);
+	cursor.eid = eid;
+	cursor.pid = pid;
+	cursor.opid = -1;
+	cursor.oeid = 0;
+	if(rc == RC_NO_SUCH_RECORD)
+		return RC_NO_SUCH_RECORD;
+
+    return 0;
+}
+
+/*
+ * Position the cursor at the last index entry whose key is not larger
+ * than searchKey, to be read with readBackward().
+ * @param searchKey[IN] the key to find
+ * @param cursor[OUT] the cursor pointing to the last entry with a key
+ *                    not larger than searchKey. cursor.pid is -1 if
+ *                    all keys are larger than searchKey.
+ * @return 0 if searchKey is found. Othewise an error code
+ */
+RC BTreeIndex::locateLast(int searchKey, IndexCursor& cursor)
+{
+	cursor.pid = -1;
+	cursor.eid = 0;
+	cursor.opid = -1;
+	cursor.oeid = 0;
+	if(rootPid == -1)
+		return RC_NO_SUCH_RECORD;
+	PageId pid;
+	locateLeaf(searchKey, pid);
+
+	RC rc;
+	if ((rc = readLeaf(pid)) < 0)
+		return rc;
+	int eid;
+	int key;
+	RecordId rid;
+	leaf.locate(searchKey, eid);
+	while (leaf.readEntry(eid, key, rid) == 0 && key == searchKey)
+		eid++;
+
+	// the entries in front of the leaf are all smaller than searchKey
+	if (eid == 0)
+	{
+		if ((pid = leaf.getPrevNodePtr()) == -1)
+			return RC_NO_SUCH_RECORD;
+		if ((rc = readLeaf(pid)) < 0)
+			return rc;
+		eid = leaf.getKeyCount();
+	}
+	cursor.pid = pid;
+	cursor.eid = eid - 1;
+	cursor.opid = leaf.getOverflowPtr(eid - 1);
+	leaf.readEntry(eid - 1, key, rid);
+	return (key == searchKey) ? 0 : RC_NO_SUCH_RECORD;
+}
+
+/*
+ * Descend from the root to the leaf node where searchKey belongs.
+ * The non-leaf nodes on the way are recorded in path.
+ */
+RC BTreeIndex::locateLeaf(int searchKey, PageId& pid)
+{
+	// try the learned model first. path is not set in this case, but the
+	// model is dropped before anything is inserted
+	if (!segments.empty() && predictLeaf(searchKey, pid) == 0)
+		return 0;
+
+	int level = 0;
+	if(treeHeight > 1)
+	{
+		BTNonLeafNode n;
+		n.read(rootPid, pf);
+		path[0] = rootPid;
+		while(level < treeHeight)
+		{
+			level++;
+			if(level == treeHeight)
+				break; 
+			n.locateChildPtr(searchKey, pid);
+			path[level] = pid;
+			n.read(pid, pf);
+		}
+	}
+	else
+	{
+		pid = rootPid;
+	}
+	return 0;
+}
+
+/*
+ * Read the (key, rid) pair at the location specified by the index cursor,
+ * and move foward the cursor to the next entry.
+ * @param cursor[IN/OUT] the cursor pointing to an leaf-node index entry in the b+tree
+ * @param key[OUT] the key stored at the index cursor location.
+ * @param rid[OUT] the RecordId stored at the index cursor location.
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::readForward(IndexCursor& cursor, int& key, RecordId& rid)
+{
+	RC rc;
+	if(cursor.pid == -1)
+		return RC_END_OF_TREE;
+	if ((rc = readLeaf(cursor.pid)) < 0)
+		return rc;
+
+	// locate() leaves the cursor behind the last entry of the leaf when
+	// searchKey is larger than all keys in it. continue from the next leaf.
+	if(cursor.eid >= leaf.getKeyCount())
+	{
+		cursor.pid = leaf.getNextNodePtr();
+		cursor.eid = 0;
+		if(cursor.pid == -1)
+			return RC_END_OF_TREE;
+		if ((rc = readLeaf(cursor.pid)) < 0)
+			return rc;
+	}
+	RC code = leaf.readEntry(cursor.eid, key, rid);
+
+	if(cursor.opid != -1)
+	{
+		// inside the overflow pages of the run. the key comes from the leaf
+		if (overflowPid != cursor.opid)
+		{
+			if ((rc = overflow.read(cursor.opid, pf)) < 0)
+				return rc;
+			overflowPid = cursor.opid;
+		}
+		code = overflow.readEntry(cursor.oeid, rid);
+		if(++cursor.oeid < overflow.getCount())
+			return code;
+		cursor.opid = overflow.getNextNodePtr();
+		cursor.oeid = 0;
+		if(cursor.opid != -1)
+			return code;
+	}
+	else
+	{
+		// the last inline entry of a run continues in the overflow pages
+		int nextKey;
+		RecordId nextRid;
+		bool lastOfRun = (leaf.readEntry(cursor.eid+1, nextKey, nextRid) != 0 || nextKey != key);
+		if(lastOfRun && leaf.getOverflowPtr(cursor.eid) != -1)
+		{
+			cursor.opid = leaf.getOverflowPtr(cursor.eid);
+			cursor.oeid = 0;
+			return code;
+		}
+	}
+
+	if(cursor.eid == leaf.getKeyCount()-1)//last entry in current leaf, move to next node.. what if there is no next node ? what to set indexcursor to ?
+	{
+		cursor.eid = 0;
+		cursor.pid = leaf.getNextNodePtr();
+	}
+	else
+		cursor.eid+=1;
+
+	return code;
+}
+
+/*
+ * Read the (key, rid) pair at the location specified by the index cursor,
+ * and move backward the cursor to the previous entry.
+ * The overflow pages of a run are read before its entries in the leaf.
+ * @param cursor[IN/OUT] the cursor set by locateLast() or readBackward()
+ * @param key[OUT] the key stored at the index cursor location.
+ * @param rid[OUT] the RecordId stored at the index cursor location.
+ * @return error code. RC_END_OF_TREE if there are no more entries
+ */
+RC BTreeIndex::readBackward(IndexCursor& cursor, int& key, RecordId& rid)
+{
+	RC rc;
+	if(cursor.pid == -1)
+		return RC_END_OF_TREE;
+	if ((rc = readLeaf(cursor.pid)) < 0)
+		return rc;
+	RC code = leaf.readEntry(cursor.eid, key, rid);
+	if (code < 0)
+		return code;
+
+	if(cursor.opid != -1)
+	{
+		// inside the overflow pages of the run. the key comes from the leaf
+		if (overflowPid != cursor.opid)
+		{
+			if ((rc = overflow.read(cursor.opid, pf)) < 0)
+				return rc;
+			overflowPid = cursor.opid;
+		}
+		code = overflow.readEntry(cursor.oeid, rid);
+		if(++cursor.oeid >= overflow.getCount())
+		{
+			cursor.opid = overflow.getNextNodePtr();
+			cursor.oeid = 0;
+		}
+		return code;
+	}
+
+	// move to the previous entry. a new run starts with its overflow pages
+	int prevKey;
+	RecordId prevRid;
+	if(cursor.eid > 0)
+	{
+		leaf.readEntry(--cursor.eid, prevKey, prevRid);
+		if (prevKey != key)
+			cursor.opid = leaf.getOverflowPtr(cursor.eid);
+		return code;
+	}
+	cursor.pid = leaf.getPrevNodePtr();
+	if(cursor.pid != -1)
+	{
+		if ((rc = readLeaf(cursor.pid)) < 0)
+			return rc;
+		cursor.eid = leaf.getKeyCount() - 1;
+		cursor.opid = leaf.getOverflowPtr(cursor.eid);
+	}
+	return code;
+}
+
+/*
+ * Decode the leaf node pid into leaf, unless it is already there.
+ */
+RC BTreeIndex::readLeaf(PageId pid)
+{
+	RC rc;
+	if (pid == leafPid)
+		return 0;
+	leafPid = -1;
+	if ((rc = leaf.read(pid, pf)) < 0)
+		return rc;
+	leafPid = pid;
+	return 0;
+}
+
+/*
+ * Look up many keys with one walk of the tree.
+ * @param searchKeys[IN/OUT] the keys to find. The vector is sorted
+ *                           and duplicates are removed by this function.
+ * @param entries[OUT] the (key, rid) pairs found in the index
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::locateMany(vector<int>& searchKeys, vector<pair<int, RecordId> >& entries)
+{
+	entries.clear();
+	if(rootPid == -1 || searchKeys.empty())
+		return 0;
+	sort(searchKeys.begin(), searchKeys.end());
+	searchKeys.erase(unique(searchKeys.begin(), searchKeys.end()), searchKeys.end());
+	return locateMany(rootPid, treeHeight, searchKeys, 0, searchKeys.size(), entries);
+}
+
+/*
+ * Find searchKeys[begin, end) in the subtree rooted at pid.
+ */
+RC BTreeIndex::locateMany(PageId pid, int height, const vector<int>& searchKeys,
+                          int begin, int end, LeafEntries& entries)
+{
+	RC rc;
+	if (height == 1)
+	{
+		BTLeafNode l;
+		if ((rc = l.read(pid, pf)) < 0)
+			return rc;
+
+		for (int i = begin; i < end; i++)
+		{
+			int eid;
+			int key;
+			RecordId rid;
+			l.locate(searchKeys[i], eid);
+
+			// a run never continues in the next leaf, but it may continue
+			// in overflow pages
+			PageId head = -1;
+			while (l.readEntry(eid, key, rid) == 0 && key == searchKeys[i])
+			{
+				entries.push_back(make_pair(key, rid));
+				head = l.getOverflowPtr(eid++);
+			}
+			if (head != -1 && (rc = readOverflow(head, searchKeys[i], entries)) < 0)
+				return rc;
+		}
+		return 0;
+	}
+
+	BTNonLeafNode n;
+	if ((rc = n.read(pid, pf)) < 0)
+		return rc;
+
+	// route the search keys to the children the same way locateChildPtr() does
+	PageId child = n.getFirstChildPtr();
+	int count = n.getKeyCount();
+	int i = begin;
+	for (int eid = 0; eid <= count && i < end; eid++)
+	{
+		bool last = (eid == count);
+		int sepKey = 0;
+		PageId nextPid = -1;
+		if (!last)
+			n.readEntry(eid, sepKey, nextPid);
+
+		int j = i;
+		while (j < end && (last || searchKeys[j] < sepKey))
+			j++;
+		if (j > i)
+		{
+			if ((rc = locateMany(child, height-1, searchKeys, i, j, entries)) < 0)
+				return rc;
+			i = j;
+		}
+		child = nextPid;
+	}
+	return 0;
+}
+
+/*
+ * Find keys that split [lower, upper] into sub-ranges for parallel scans.
+ * @param lower[IN] the smallest key of the range
+ * @param upper[IN] the largest key of the range
+ * @param parts[IN] # sub-ranges wanted
+ * @param splits[OUT] the smallest key of each sub-range but the first
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::splitRange(int lower, int upper, int parts, vector<int>& splits)
+{
+	RC rc;
+	vector<PageId> level(1, rootPid);
+	splits.clear();
+	if (rootPid == -1 || lower >= upper)
+		return 0;
+
+	// walk down the tree a level at a time, visiting the nodes whose
+	// subtree overlaps [lower, upper]
+	for (int height = treeHeight; height > 1 && (int) splits.size() < parts - 1; height--)
+	{
+		vector<PageId> children;
+		splits.clear();
+		for (unsigned i = 0; i < level.size(); i++)
+		{
+			BTNonLeafNode n;
+			if ((rc = n.read(level[i], pf)) < 0)
+				return rc;
+
+			// the child before the key holds the keys smaller than it
+			PageId child = n.getFirstChildPtr();
+			for (int eid = 0; eid <= n.getKeyCount(); eid++)
+			{
+				int sepKey = INT_MAX;
+				PageId nextPid = -1;
+				if (eid < n.getKeyCount())
+					n.readEntry(eid, sepKey, nextPid);
+				if (sepKey > lower)
+					children.push_back(child);
+				if (sepKey > lower && sepKey <= upper && eid < n.getKeyCount())
+					splits.push_back(sepKey);
+				if (sepKey > upper)
+					break;
+				child = nextPid;
+			}
+		}
+		level.swap(children);
+	}
+
+	// keep parts-1 keys spread evenly over the ones found
+	if ((int) splits.size() > parts - 1)
+	{
+		vector<int> even;
+		for (int i = 1; i < parts; i++)
+			even.push_back(splits[(long long) i * splits.size() / parts]);
+		even.erase(unique(even.begin(), even.end()), even.end());
+		splits.swap(even);
+	}
+	return 0;
+}
+
+/*
+ * Build a learned model of the leaf level of the tree.
+ * @return error code. 0 if no error
+ */
+RC BTreeIndex::buildModel()
+{
+	RC rc;
+	dropModel();
+	if (rootPid == -1)
+		return 0;
+
+	// collect the first key and the PageId of every leaf node, left to right
+	vector<int> keys;
+	vector<PageId> pids;
+	PageId pid;
+	locateLeaf(INT_MIN, pid);
+	for (; pid != -1; pid = leaf.getNextNodePtr())
+	{
+		int key;
+		RecordId rid;
+		if ((rc = readLeaf(pid)) < 0)
+			return rc;
+		if (leaf.readEntry(0, key, rid) < 0)
+			continue;
+		keys.push_back(key);
+		pids.push_back(pid);
+	}
+
+	// greedily extend each segment while a line through its first point
+	// stays within MODEL_MAX_ERROR of all its points (the slope range
+	// [low, high] shrinks with each point), and the leaf nodes are on
+	// consecutive pages, so that the page is computed from the position
+	int total = keys.size();
+	for (int begin = 0, end; begin < total; begin = end)
+	{
+		double low = 0, high = 1e300;
+		for (end = begin + 1; end < total && pids[end] == pids[end-1] + 1; end++)
+		{
+			double dx = (double)keys[end] - keys[begin];
+			double dy = end - begin;
+			double l = max(low, (dy - MODEL_MAX_ERROR) / dx);
+			double h = min(high, (dy + MODEL_MAX_ERROR) / dx);
+			if (l > h)
+				break;
+			low = l;
+			high = h;
+		}
+
+		Segment seg;
+		seg.key = keys[begin];
+		seg.pid = pids[begin];
+		seg.count = end - begin;
+		seg.slope = (seg.count == 1) ? 0 : (low + high) / 2;
+		segments.push_back(seg);
+	}
+
+	// save the segments at the end of the file
+	char buffer[PageFile::PAGE_SIZE];
+	int perPage = PageFile::PAGE_SIZE / SEGMENT_SIZE;
+	modelPid = pf.endPid();
+	for (int i = 0; i < (int)segments.size(); i += perPage)
+	{
+		memset(buffer, 0, sizeof(buffer));
+		char* p = buffer;
+		for (int j = i; j < i + perPage && j < (int)segments.size(); j++)
+		{
+			memcpy(p, &segments[j].key, sizeof(int));
+			memcpy(p + sizeof(int), &segments[j].pid, sizeof(PageId));
+			memcpy(p + sizeof(int) + sizeof(PageId), &segments[j].count, sizeof(int));
+			memcpy(p + sizeof(int) + sizeof(PageId) + sizeof(int), &segments[j].slope, sizeof(double));
+			p += SEGMENT_SIZE;
+		}
+		if ((rc = pf.write(modelPid + i / perPage, buffer)) < 0)
+			return rc;
+	}
+	return 0;
+}
+
+/*
+ * Check whether the index has a learned model (see buildModel()).
+ * @return true if the index has a learned model
+ */
+bool BTreeIndex::hasModel()
+{
+	return modelPid != -1;
+}
+
+/*
+ * Read count segments of the learned model from the pages at modelPid.
+ */
+RC BTreeIndex::readModel(int count)
+{
+	RC rc;
+	char buffer[PageFile::PAGE_SIZE];
+	int perPage = PageFile::PAGE_SIZE / SEGMENT_SIZE;
+	segments.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		if (i % perPage == 0 && (rc = pf.read(modelPid + i / perPage, buffer)) < 0)
+		{
+			segments.clear();
+			modelPid = -1;
+			return rc;
+		}
+		const char* p = buffer + (i % perPage) * SEGMENT_SIZE;
+		memcpy(&segments[i].key, p, sizeof(int));
+		memcpy(&segments[i].pid, p + sizeof(int), sizeof(PageId));
+		memcpy(&segments[i].count, p + sizeof(int) + sizeof(PageId), sizeof(int));
+		memcpy(&segments[i].slope, p + sizeof(int) + sizeof(PageId) + sizeof(int), sizeof(double));
+	}
+	return 0;
+}
+
+/*
+ * Forget the learned model. Its pages are left unused in the file.
+ */
+void BTreeIndex::dropModel()
+{
+	segments.clear();
+	modelPid = -1;
+}
+
+/*
+ * Find the leaf node where searchKey belongs with the learned model.
+ * The predicted leaf is checked against searchKey, and the leaf nodes
+ * next to it are tried when the prediction is off.
+ * @return 0 if the leaf was found. Otherwise an error code, and the
+ *         tree has to be searched from the root
+ */
+RC BTreeIndex::predictLeaf(int searchKey, PageId& pid)
+{
+	// the last segment that starts at or before searchKey
+	int low = 0, high = segments.size();
+	while (high - low > 1)
+	{
+		int mid = low + (high - low) / 2;
+		if (segments[mid].key <= searchKey)
+			low = mid;
+		else
+			high = mid;
+	}
+	const Segment& seg = segments[low];
+	double pos = seg.slope * ((double)searchKey - seg.key) + 0.5;
+	int offset = (pos < 0) ? 0 : (pos >= seg.count) ? seg.count - 1 : (int)pos;
+	pid = seg.pid + offset;
+
+	int key;
+	RecordId rid;
+	for (int step = 0; step <= MODEL_MAX_ERROR + 1; step++)
+	{
+		if (readLeaf(pid) < 0 || leaf.readEntry(0, key, rid) < 0)
+			return RC_NO_SUCH_RECORD;
+		if (searchKey < key)
+		{
+			// searchKey is in one of the leaves on the left
+			if (leaf.getPrevNodePtr() == -1)
+				return 0;
+			pid = leaf.getPrevNodePtr();
+			continue;
+		}
+		leaf.readEntry(leaf.getKeyCount() - 1, key, rid);
+		PageId nextPid = leaf.getNextNodePtr();
+		if (searchKey <= key || nextPid == -1)
+			return 0;
+
+		// searchKey is beyond the last key. it belongs to the next leaf
+		// only if the next leaf starts at or before searchKey
+		if (readLeaf(nextPid) < 0 || leaf.readEntry(0, key, rid) < 0)
+			return RC_NO_SUCH_RECORD;
+		if (searchKey < key)
+			return 0;
+		pid = nextPid;
+	}
+	return RC_NO_SUCH_RECORD;
+}
+
+RC BTreeIndex::printTree()
+{
+	printTree(rootPid, treeHeight, 1, 10000);
+	return 0;
+}
+
+RC BTreeIndex::printTree(PageId root, int height, int start, int end)
+{
+#if DEBUG
+	if (!height)return 0;
+
+	BTLeafNode leaf;
+	int rc;
+	RecordId rid;
+	int key, readKey;
+	IndexCursor ic;
+
+	for (int key=start; key<end; key++){
+		rc = locate(key, ic);
+		if (rc){
+			fprintf(stdout, "key: %i not found\n", key);
+		}
+		rc = readForward(ic, readKey, rid);
+		fprintf(stdout, "key: %i readKey:%i rid pid:%i sid:%i\n", key, readKey, rid.pid, rid.sid);
+	}
+#endif
+	return 0;
 }
\ No newline at end of file
@@ -1,108 +1,260 @@
-/*
- * Copyright (C) 2008 by The Regents of the University of California
- * Redistribution of this file is permitted under the terms of the GNU
- * Public License (GPL).
- *
- * @author Junghoo "John" Cho <cho AT cs.ucla.edu>
- * @date 3/24/2008
- */
-
-#ifndef BTREEINDEX_H
-#define BTREEINDEX_H
-
-#include "Bruinbase.h"
-#include "PageFile.h"
-#include "RecordFile.h"
-             
-/**
- * The data structure to point to a particular entry at a b+tree leaf node.
- * An IndexCursor consists of pid (PageId of the leaf node) and 
- * eid (the location of the index entry inside the node).
- * IndexCursor is used for index lookup and traversal.
- */
-typedef struct {
-  // PageId of the index entry
-  PageId  pid;  
-  // The entry number inside the node
-  int     eid;  
-} IndexCursor;
-
-/**
- * Implements a B-Tree index for bruinbase.
- * 
- */
-class BTreeIndex {
- public:
-  BTreeIndex();
-
-  /**
-   * Open the index file in read or write mode.
-   * Under 'w' mode, the index file should be created if it does not exist.
-   * @param indexname[IN] the name of the index file
-   * @param mode[IN] 'r' for read, 'w' for write
-   * @return error code. 0 if no error
-   */
-  RC open(const std::string& indexname, char mode);
-
-  /**
-   * Close the index file.
-   * @return error code. 0 if no error
-   */
-  RC close();
-    
-  /**
-   * Insert (key, RecordId) pair to the index.
-   * @param key[IN] the key for the value inserted into the index
-   * @param rid[IN] the RecordId for the record being inserted into the index
-   * @return error code. 0 if no error
-   */
-  RC insert(int key, const RecordId& rid);
-
-  /**
-   * Run the standard B+Tree key search algorithm and identify the
-   * leaf node where searchKey may exist. If an index entry with
-   * searchKey exists in the leaf node, set IndexCursor to its location 
-   * (i.e., IndexCursor.pid = PageId of the leaf node, and
-   * IndexCursor.eid = the searchKey index entry number.) and return 0. 
-   * If not, set IndexCursor.pid = PageId of the leaf node and 
-   * IndexCursor.eid = the index entry immediately after the largest 
-   * index key that is smaller than searchKey, and return the error 
-   * code RC_NO_SUCH_RECORD.
-   * Using the returned "IndexCursor", you will have to call readForward()
-   * to retrieve the actual (key, rid) pair from the index.
-   * @param key[IN] the key to find
-   * @param cursor[OUT] the cursor pointing to the index entry with 
-   *                    searchKey or immediately behind the largest key 
-   *                    smaller than searchKey.
-   * @return 0 if searchKey is found. Othewise, an error code
-   */
-  RC locate(int searchKey, IndexCursor& cursor);
-
-  /**
-   * Read the (key, rid) pair at the location specified by the index cursor,
-   * and move foward the cursor to the next entry.
-   * @param cursor[IN/OUT] the cursor pointing to an leaf-node index entry in the b+tree
-   * @param key[OUT] the key stored at the index cursor location
-   * @param rid[OUT] the RecordId stored at the index cursor location
-   * @return error code. 0 if no error
-   */
-  RC readForward(IndexCursor& cursor, int& key, RecordId& rid);
-  RC printTree();
-
- private:
-  PageFile pf;         /// the PageFile used to store the actual b+tree in disk
-
-  PageId   rootPid;    /// the PageId of the root node
-  int      treeHeight; /// the height of the tree
-  /// Note that the content of the above two variables will be gone when
-  /// this class is destructed. Make sure to store the values of the two 
-  /// variables in disk, so that they can be reconstructed when the index
-  /// is opened again later.
-  PageId path[100];
-  RC insert_into_parent(int level, PageId childpid, int key, PageId sib_pid);
-  RC printTree(PageId root, int height, int start, int end);
-
-  bool not_read;
-};
-
-#endif /* BTREEINDEX_H */
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ *
+ * @author Junghoo "John" Cho <cho AT cs.ucla.edu>
+ * @date 3/24/2008
+ */
+
+#ifndef BTREEINDEX_H
+#define BTREEINDEX_H
+
+#include "Bruinbase.h"
+#include "PageFile.h"
+#include "RecordFile.h"
+#include "BTreeNode.h"
+#include <vector>
+#include <utility>
+             
+/**
+ * The data structure to point to a particular entry at a b+tree leaf node.
+ * An IndexCursor consists of pid (PageId of the leaf node) and 
+ * eid (the location of the index entry inside the node).
+ * While the overflow pages of a run are read, opid and oeid point to the
+ * entry in the overflow page, and eid stays at the last entry of the run.
+ * IndexCursor is used for index lookup and traversal.
+ */
+typedef struct {
+  // PageId of the index entry
+  PageId  pid;  
+  // The entry number inside the node
+  int     eid;  
+  // PageId of the overflow page. -1 if the cursor is inside the leaf node
+  PageId  opid;
+  // The entry number inside the overflow page
+  int     oeid;
+} IndexCursor;
+
+/**
+ * Implements a B-Tree index for bruinbase.
+ * 
+ */
+class BTreeIndex {
+ public:
+  BTreeIndex();
+
+  /**
+   * Open the index file in read or write mode.
+   * Under 'w' mode, the index file should be created if it does not exist.
+   * @param indexname[IN] the name of the index file
+   * @param mode[IN] 'r' for read, 'w' for write
+   * @return error code. 0 if no error
+   */
+  RC open(const std::string& indexname, char mode);
+
+  /**
+   * Close the index file.
+   * @return error code. 0 if no error
+   */
+  RC close();
+    
+  /**
+   * Insert (key, RecordId) pair to the index.
+   * @param key[IN] the key for the value inserted into the index
+   * @param rid[IN] the RecordId for the record being inserted into the index
+   * @return error code. 0 if no error
+   */
+  RC insert(int key, const RecordId& rid);
+
+  /**
+   * Insert a batch of (key, RecordId) pairs to the index.
+   * The batch is sorted by key first, and the tree is descended once per
+   * leaf node that receives new entries. All new entries of a leaf are
+   * merged with its old entries in one pass, and the leaf is split into
+   * as many nodes as needed, so that every touched node is written once.
+   * @param entries[IN/OUT] the (key, RecordId) pairs to insert.
+   *                        The vector is sorted by this function.
+   * @return error code. 0 if no error
+   */
+  RC insertBatch(std::vector<std::pair<int, RecordId> >& entries);
+
+  /**
+   * Run the standard B+Tree key search algorithm and identify the
+   * leaf node where searchKey may exist. If an index entry with
+   * searchKey exists in the leaf node, set IndexCursor to its location 
+   * (i.e., IndexCursor.pid = PageId of the leaf node, and
+   * IndexCursor.eid = the searchKey index entry number.) and return 0. 
+   * If not, set IndexCursor.pid = PageId of the leaf node and 
+   * IndexCursor.eid = the index entry immediately after the largest 
+   * index key that is smaller than searchKey, and return the error 
+   * code RC_NO_SUCH_RECORD.
+   * Using the returned "IndexCursor", you will have to call readForward()
+   * to retrieve the actual (key, rid) pair from the index.
+   * @param key[IN] the key to find
+   * @param cursor[OUT] the cursor pointing to the index entry with 
+   *                    searchKey or immediately behind the largest key 
+   *                    smaller than searchKey.
+   * @return 0 if searchKey is found. Othewise, an error code
+   */
+  RC locate(int searchKey, IndexCursor& cursor);
+
+  /**
+   * Read the (key, rid) pair at the location specified by the index cursor,
+   * and move foward the cursor to the next entry.
+   * @param cursor[IN/OUT] the cursor pointing to an leaf-node index entry in the b+tree
+   * @param key[OUT] the key stored at the index cursor location
+   * @param rid[OUT] the RecordId stored at the index cursor location
+   * @return error code. 0 if no error
+   */
+  RC readForward(IndexCursor& cursor, int& key, RecordId& rid);
+
+  /**
+   * Position the cursor at the last index entry whose key is not larger
+   * than searchKey. Use readBackward() to retrieve the entries from there
+   * in descending key order.
+   * @param searchKey[IN] the key to find
+   * @param cursor[OUT] the cursor pointing to the last entry with a key
+   *                    not larger than searchKey
+   * @return 0 if searchKey is found. Othewise, an error code
+   */
+  RC locateLast(int searchKey, IndexCursor& cursor);
+
+  /**
+   * Read the (key, rid) pair at the location specified by the index cursor,
+   * and move backward the cursor to the previous entry.
+   * @param cursor[IN/OUT] the cursor pointing to an leaf-node index entry in the b+tree
+   * @param key[OUT] the key stored at the index cursor location
+   * @param rid[OUT] the RecordId stored at the index cursor location
+   * @return error code. 0 if no error
+   */
+  RC readBackward(IndexCursor& cursor, int& key, RecordId& rid);
+
+  /**
+   * Look up many keys with one walk of the tree.
+   * The search keys are sorted first, and each node on the way is read
+   * once for all the search keys that fall under it. Every (key, rid)
+   * pair in the index whose key is one of the search keys is appended
+   * to entries in key order.
+   * @param searchKeys[IN/OUT] the keys to find. The vector is sorted
+   *                           and duplicates are removed by this function.
+   * @param entries[OUT] the (key, rid) pairs found in the index
+   * @return error code. 0 if no error
+   */
+  RC locateMany(std::vector<int>& searchKeys,
+                std::vector<std::pair<int, RecordId> >& entries);
+
+  /**
+   * Find keys that split [lower, upper] into sub-ranges under about the
+   * same # leaf nodes, so that the sub-ranges can be scanned in parallel.
+   * The separator keys of the root are taken first, then those of the
+   * level below it, until there are enough of them.
+   * @param lower[IN] the smallest key of the range
+   * @param upper[IN] the largest key of the range
+   * @param parts[IN] # sub-ranges wanted
+   * @param splits[OUT] the smallest key of each sub-range but the first,
+   *                    in ascending order. At most parts-1 keys
+   * @return error code. 0 if no error
+   */
+  RC splitRange(int lower, int upper, int parts, std::vector<int>& splits);
+
+  /**
+   * Build a learned model of the leaf level for a table that is only
+   * queried from now on. The model is a piecewise-linear function from a
+   * key to the position of its leaf node within a run of leaf nodes on
+   * consecutive pages, with an error of at most a leaf or two. locate()
+   * and locateLast() read the predicted leaf instead of descending the
+   * tree. The model is saved in the index file, and dropped by the next
+   * insert() or insertBatch().
+   * @return error code. 0 if no error
+   */
+  RC buildModel();
+
+  /**
+   * Check whether the index has a learned model (see buildModel()).
+   * @return true if the index has a learned model
+   */
+  bool hasModel();
+
+  /**
+   * Get the # entries in the index, kept in the header page by insert()
+   * and insertBatch().
+   * @return # (key, RecordId) pairs in the index, or -1 if the index was
+   *         written before its entries were counted or an insert failed
+   */
+  int getEntryCount() const { return entryCount; }
+
+  /**
+   * Get the smallest and the largest key in the index from the header
+   * page, without reading a node.
+   * @param min[OUT] the smallest key
+   * @param max[OUT] the largest key
+   * @return 0 if the keys are known, RC_END_OF_TREE if the index is empty,
+   *         RC_NO_SUCH_RECORD if the index does not count its entries
+   */
+  RC getKeyRange(int& min, int& max) const;
+
+  RC printTree();
+
+ private:
+  PageFile pf;         /// the PageFile used to store the actual b+tree in disk
+
+  PageId   rootPid;    /// the PageId of the root node
+  int      treeHeight; /// the height of the tree
+  /// Note that the content of the above two variables will be gone when
+  /// this class is destructed. Make sure to store the values of the two 
+  /// variables in disk, so that they can be reconstructed when the index
+  /// is opened again later.
+  int      entryCount; /// # entries in the index, -1 if not known
+  int      minKey;     /// the smallest key, if entryCount > 0
+  int      maxKey;     /// the largest key, if entryCount > 0
+  void countEntries(int lower, int upper, int count, RC rc);
+  PageId path[100];
+  RC insert_into_parent(int level, PageId childpid, int key, PageId sib_pid);
+  RC printTree(PageId root, int height, int start, int end);
+
+  typedef std::vector<std::pair<int, RecordId> > LeafEntries;
+  typedef std::vector<std::pair<int, PageId> > Siblings;
+  RC insertBatch(PageId pid, int height, const LeafEntries& entries,
+                 int begin, int end, Siblings& siblings);
+  RC locateMany(PageId pid, int height, const std::vector<int>& searchKeys,
+                int begin, int end, LeafEntries& entries);
+  RC locateLeaf(int searchKey, PageId& pid);
+  RC writeLeafNodes(PageId pid, PageId prevPid, PageId nextPid,
+                    const LeafEntries& entries,
+                    const std::vector<PageId>& overflows, Siblings& siblings);
+  RC setPrevPtr(PageId pid, PageId prevPid);
+  RC fillLeafNode(BTLeafNode& l, const LeafEntries& entries,
+                  const std::vector<PageId>& overflows, int begin, int end);
+  RC insertOverflow(PageId& head, const LeafEntries& entries, int begin, int end);
+  RC readOverflow(PageId head, int key, LeafEntries& entries);
+  RC writeNonLeafNodes(PageId pid, const std::vector<int>& keys,
+                       const std::vector<PageId>& children, Siblings& siblings);
+
+  bool not_read;
+
+  /// a piece of the learned model: the leaf nodes from the one starting
+  /// with key are on count consecutive pages starting at pid, and the
+  /// leaf of a key k is predicted at pid + slope * (k - key)
+  typedef struct {
+    int    key;
+    PageId pid;
+    int    count;
+    double slope;
+  } Segment;
+  std::vector<Segment> segments;  /// the learned model. empty if there is none
+  PageId   modelPid;   /// the first page of the saved model. -1 if there is none
+  RC readModel(int count);
+  void dropModel();
+  RC predictLeaf(int searchKey, PageId& pid);
+
+  /// the last leaf node and overflow node read by locate() and readForward(),
+  /// so that a scan decodes each node once
+  BTLeafNode     leaf;
+  PageId         leafPid;
+  BTOverflowNode overflow;
+  PageId         overflowPid;
+  RC readLeaf(PageId pid);
+};
+
+#endif /* BTREEINDEX_H */
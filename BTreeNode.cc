@@ -1,405 +1,922 @@
-#include "BTreeNode.h"
-#include <string.h>
-#include <cstdio>
-using namespace std;
-
-
-
-// For each leaf node, we create a integer in beginning of the node buffer to record node entry count. 
-// At the end of the buffer, there is a pageid pointing to the next page.
-// --------------------------------------------------------------------------------------------------
-// |--count(4 bytes)--|--node entries(12 bytes for each)--|--some unused bytes--|--pageid(4 bytes)--|
-// --------------------------------------------------------------------------------------------------
-
-// For each entry of a leaf node in buffer,
-// ----------------------------------------
-// |--key(4 bytes)--|--RecordId(8 bytes)--|
-// ----------------------------------------
-
-
-/*
- * Read the content of the node from the page pid in the PageFile pf.
- * @param pid[IN] the PageId to read
- * @param pf[IN] PageFile to read from
- * @return 0 if successful. Return an error code if there is an error.
- */
-RC BTLeafNode::read(PageId pid, const PageFile& pf)
-{
-	return pf.read(pid, buffer);
-}
-    
-/*
- * Write the content of the node to the page pid in the PageFile pf.
- * @param pid[IN] the PageId to write to
- * @param pf[IN] PageFile to write to
- * @return 0 if successful. Return an error code if there is an error.
- */
-RC BTLeafNode::write(PageId pid, PageFile& pf)
-{
-	return pf.write(pid, buffer);
-}
-
-/*
- * Return the number of keys stored in the node.
- * @return the number of keys in the node
- */
-int BTLeafNode::getKeyCount()
-{
-	int count;
-	memcpy(&count, buffer, sizeof(count));
-	return count;
-}
-
-/*
- * Insert a (key, rid) pair to the node.
- * @param key[IN] the key to insert
- * @param rid[IN] the RecordId to insert
- * @return 0 if successful. Return an error code if the node is full.
- */
-RC BTLeafNode::insert(int key, const RecordId& rid)
-{
-	int count = getKeyCount();
-
-	if (count==MAX_NODE_SIZE)
-		return RC_NODE_FULL;
-
-	int startPos = sizeof(count);
-	int i;
-	locate(key,i);
-	startPos += i*ENTRY_SIZE;
-
-	// move other entries and insert the new entry
-	memmove(buffer+startPos+ENTRY_SIZE, buffer+startPos, (count-i)*ENTRY_SIZE);
-	memcpy(buffer+startPos, &key, sizeof(key));
-	memcpy(buffer+startPos+sizeof(key), &rid, sizeof(rid));
-
-	// update count;
-	count++;
-	memcpy(buffer, &count, sizeof(count));
-
-	return 0;
-}
-
-/*
- * Insert the (key, rid) pair to the node
- * and split the node half and half with sibling.
- * The first key of the sibling node is returned in siblingKey.
- * @param key[IN] the key to insert.
- * @param rid[IN] the RecordId to insert.
- * @param sibling[IN] the sibling node to split with. This node MUST be EMPTY when this function is called.
- * @param siblingKey[OUT] the first key in the sibling node after split.
- * @return 0 if successful. Return an error code if there is an error.
- */
-RC BTLeafNode::insertAndSplit(int key, const RecordId& rid, 
-                              BTLeafNode& sibling, int& siblingKey)
-{
-	int count = getKeyCount();
-
-	int eid;
-	locate(key,eid);
-
-	int leftSize = (count+2)/2;
-	int rightSize = count+1 - leftSize;
-
-	int curKey;
-	RecordId curRid;
-	if (eid<leftSize){
-		while(count> leftSize-1){
-			readEntry(--count, curKey, curRid);
-			sibling.insert(curKey, curRid);
-		}
-		// update count
-		memcpy(buffer, &count, sizeof(count));
-		//insert uses old count otherwise
-		insert(key, rid);
-	}else{
-		while(count> leftSize){
-			readEntry(--count, curKey, curRid);
-			sibling.insert(curKey, curRid);
-		}
-		sibling.insert(key, rid);
-		// update count
-		memcpy(buffer, &count, sizeof(count));
-
-	}
-
-	if (sibling.readEntry(0, curKey, curRid)<0)return RC_END_OF_TREE;
-	siblingKey = curKey;
-
-	return 0;
-}
-
-/**
- * If searchKey exists in the node, set eid to the index entry
- * with searchKey and return 0. If not, set eid to the index entry
- * immediately after the largest index key that is smaller than searchKey,
- * and return the error code RC_NO_SUCH_RECORD.
- * Remember that keys inside a B+tree node are always kept sorted.
- * @param searchKey[IN] the key to search for.
- * @param eid[OUT] the index entry number with searchKey or immediately
-                   behind the largest key smaller than searchKey.
- * @return 0 if searchKey is found. Otherwise return an error code.
- */
-RC BTLeafNode::locate(int searchKey, int& eid)
-{
-	int count = getKeyCount();
-	eid = count;
-
-	for(int i=0; i<count; i++){
-		int curKey;
-		memcpy(&curKey, buffer+sizeof(count)+ENTRY_SIZE*i, sizeof(curKey));
-		
-		if (curKey==searchKey){
-			eid = i;
-			return 0;
-		}
-		if(curKey > searchKey)
-		{
-			eid = i;
-			return RC_NO_SUCH_RECORD;
-		}
-	}
-
-	return RC_NO_SUCH_RECORD;
-}
-
-/*
- * Read the (key, rid) pair from the eid entry.
- * @param eid[IN] the entry number to read the (key, rid) pair from
- * @param key[OUT] the key from the entry
- * @param rid[OUT] the RecordId from the entry
- * @return 0 if successful. Return an error code if there is an error.
- */
-RC BTLeafNode::readEntry(int eid, int& key, RecordId& rid)
-{
-	int count = getKeyCount();
-
-	if (eid>=count)return RC_END_OF_TREE;
-	memcpy(&key, buffer+sizeof(count)+ENTRY_SIZE*eid, sizeof(key));
-	memcpy(&rid, buffer+sizeof(count)+sizeof(key)+ENTRY_SIZE*eid, sizeof(RecordId));
-	return 0;
-}
-
-/*
- * Return the pid of the next slibling node.
- * @return the PageId of the next sibling node 
- */
-PageId BTLeafNode::getNextNodePtr()
-{
-	PageId pid;
-	memcpy(&pid, buffer+BUFFER_SIZE-sizeof(pid), sizeof(pid));
-	return pid;
-}
-
-/*
- * Set the pid of the next slibling node.
- * @param pid[IN] the PageId of the next sibling node 
- * @return 0 if successful. Return an error code if there is an error.
- */
-RC BTLeafNode::setNextNodePtr(PageId pid)
-{
-	memcpy(buffer+BUFFER_SIZE-sizeof(pid), &pid, sizeof(pid));
-	return 0;
-}
-
- BTLeafNode::BTLeafNode()
-{
-	memset(buffer, 0, sizeof(buffer));
-	int count = 0;
-	memcpy(buffer, &count, sizeof(count));
-	setNextNodePtr(-1);
-}
-// For each non-leaf node, we create a integer in beginning of the node buffer to record node key count. 
-// Right behind the count, there is a pageid pointing to the first child page.
-// --------------------------------------------------------------------------------------------------
-// |--count(4 bytes)--|--PageId(4 bytes)---|--node entries(8 bytes for each)--|--some unused bytes--|
-// --------------------------------------------------------------------------------------------------
-
-// For each entry of an non-leaf node,
-// --------------------------------------
-// |--PageId(4 bytes)--|--Key(4 bytes)--|
-// --------------------------------------
-BTNonLeafNode::BTNonLeafNode()
-{
-	memset(buffer, 0, sizeof(buffer));
-	int count = 0;
-	memcpy(buffer, &count, sizeof(count));
-}
-
-/*
- * Read the content of the node from the page pid in the PageFile pf.
- * @param pid[IN] the PageId to read
- * @param pf[IN] PageFile to read from
- * @return 0 if successful. Return an error code if there is an error.
- */
-RC BTNonLeafNode::read(PageId pid, const PageFile& pf)
-{ 
-	return pf.read(pid, buffer);
-}
-    
-/*
- * Write the content of the node to the page pid in the PageFile pf.
- * @param pid[IN] the PageId to write to
- * @param pf[IN] PageFile to write to
- * @return 0 if successful. Return an error code if there is an error.
- */
-RC BTNonLeafNode::write(PageId pid, PageFile& pf)
-{ 
-	return pf.write(pid, buffer);
-}
-
-/*
- * Return the number of keys stored in the node.
- * @return the number of keys in the node
- */
-int BTNonLeafNode::getKeyCount()
-{
-	int count;
-	memcpy(&count, buffer, sizeof(count));
-	return count;
-}
-
-
-/*
- * Insert a (key, pid) pair to the node.
- * @param key[IN] the key to insert
- * @param pid[IN] the PageId to insert
- * @return 0 if successful. Return an error code if the node is full.
- */
-RC BTNonLeafNode::insert(int key, PageId pid)
-{
-	int count = getKeyCount();
-	if (count==MAX_NODE_SIZE)return RC_NODE_FULL;
-
-	int curKey;
-	int eid;
-	for(eid=0; eid<count; eid++){
-		memcpy(&curKey, buffer+sizeof(count)+NONLEAF_ENTRY_SIZE*eid+sizeof(pid), sizeof(curKey));
-
-		if (curKey>= key){
-			break;
-		}
-	}
-
-	// move old entries first
-	memmove(buffer+sizeof(count)+sizeof(pid)+NONLEAF_ENTRY_SIZE*(eid+1), 
-		buffer+sizeof(count)+sizeof(pid)+NONLEAF_ENTRY_SIZE*eid, 
-		NONLEAF_ENTRY_SIZE*(count-eid));
-
-	// insert new entry
-	memcpy(buffer+sizeof(count)+sizeof(pid)+NONLEAF_ENTRY_SIZE*eid, &key, sizeof(key));
-	memcpy(buffer+sizeof(count)+sizeof(pid)+NONLEAF_ENTRY_SIZE*eid+sizeof(key), &pid, sizeof(pid));
-
-	// update count
-	count++;
-	memcpy(buffer, &count, sizeof(count));
-	return 0; 
-}
-
-/*
- * Insert the (key, pid) pair to the node
- * and split the node half and half with sibling.
- * The middle key after the split is returned in midKey.
- * @param key[IN] the key to insert
- * @param pid[IN] the PageId to insert
- * @param sibling[IN] the sibling node to split with. This node MUST be empty when this function is called.
- * @param midKey[OUT] the key in the middle after the split. This key should be inserted to the parent node.
- * @return 0 if successful. Return an error code if there is an error.
- */
-RC BTNonLeafNode::insertAndSplit(int key, PageId pid, BTNonLeafNode& sibling, int& midKey)
-{
-	int count = getKeyCount();
-	int leftSize = (count+1)/2;
-	int rightSize = count - leftSize;
-
-	int curKey;
-	int eid;
-	for(eid=0; eid<count; eid++){
-		memcpy(&curKey, buffer+sizeof(count)+NONLEAF_ENTRY_SIZE*eid+sizeof(pid), sizeof(curKey));
-
-		if (curKey>= key){
-			break;
-		}
-	}
-
-	// since buffer size is actually larger than max_node_size, we can insert new pair first in the current buffer and then split
-	// move old entries first
-	memmove(buffer+sizeof(count)+sizeof(PageId)+NONLEAF_ENTRY_SIZE*(eid+1), 
-		buffer+sizeof(count)+sizeof(PageId)+NONLEAF_ENTRY_SIZE*eid, 
-		NONLEAF_ENTRY_SIZE*(count-eid));
-
-	// insert new entry
-	memcpy(buffer+sizeof(count)+sizeof(PageId)+NONLEAF_ENTRY_SIZE*eid, &key, sizeof(key));
-	memcpy(buffer+sizeof(count)+sizeof(PageId)+NONLEAF_ENTRY_SIZE*eid+sizeof(key), &pid, sizeof(pid));
-
-	// set midkey
-	int midOffset = sizeof(count)+sizeof(PageId)+NONLEAF_ENTRY_SIZE*leftSize;
-	memcpy(&midKey, buffer+midOffset, sizeof(midKey));
-
-	// initialize sibling node
-	PageId pid1, pid2;
-	int firstKey;
-	memcpy(&pid1, buffer+midOffset+sizeof(midKey), sizeof(pid1));
-	memcpy(&firstKey, buffer+midOffset+sizeof(midKey)+sizeof(pid1), sizeof(firstKey));
-	memcpy(&pid2, buffer+midOffset+sizeof(midKey)*2+sizeof(pid1), sizeof(pid2));
-	sibling.initializeRoot(pid1, firstKey, pid2);
-
-	// insert the rest of entries
-	PageId newPid;
-	int newKey;
-	for (int i=1; i<rightSize; i++){
-		memcpy(&newKey, buffer+midOffset+NONLEAF_ENTRY_SIZE*(i+1), sizeof(newKey));
-		memcpy(&newPid, buffer+midOffset+NONLEAF_ENTRY_SIZE*(i+1)+sizeof(newKey), sizeof(newPid));
-		sibling.insert(newKey, newPid);
-	}
-
-	// update count
-	count = leftSize;
-	memcpy(buffer, &count, sizeof(count));
-
-	return 0;
-}
-
-/*
- * Given the searchKey, find the child-node pointer to follow and
- * output it in pid.
- * @param searchKey[IN] the searchKey that is being looked up.
- * @param pid[OUT] the pointer to the child node to follow.
- * @return 0 if successful. Return an error code if there is an error.
- */
-RC BTNonLeafNode::locateChildPtr(int searchKey, PageId& pid)
-{
-	int count = getKeyCount();
-
-	int curKey;
-	for(int eid=0; eid<count; eid++){
-		memcpy(&curKey, buffer+sizeof(count)+NONLEAF_ENTRY_SIZE*eid+sizeof(pid), sizeof(curKey));
-
-		if (curKey>= searchKey){
-			memcpy(&pid, buffer+sizeof(count)+NONLEAF_ENTRY_SIZE*eid, sizeof(pid));
-			return 0;
-		}
-	}
-	memcpy(&pid, buffer+sizeof(count)+NONLEAF_ENTRY_SIZE*count, sizeof(pid));
-	return 0;
-}
-
-/*
- * Initialize the root node with (pid1, key, pid2).
- * @param pid1[IN] the first PageId to insert
- * @param key[IN] the key that should be inserted between the two PageIds
- * @param pid2[IN] the PageId to insert behind the key
- * @return 0 if successful. Return an error code if there is an error.
- */
-RC BTNonLeafNode::initializeRoot(PageId pid1, int key, PageId pid2)
-{
-	// write count
-	int count=1;
-	memcpy(buffer, &count, sizeof(count));
-
-	memcpy(buffer+sizeof(count), &pid1, sizeof(pid1));
-	memcpy(buffer+sizeof(count)+sizeof(pid1), &key, sizeof(key));
-	memcpy(buffer+sizeof(count)+sizeof(pid1)+sizeof(key), &pid2, sizeof(pid2));
-
-	return 0;
-}
+#include "BTreeNode.h"
+#include <string.h>
+#include <cstdio>
+using namespace std;
+
+
+
+// For each leaf node, we create a integer in beginning of the node buffer to record node entry count. 
+// Right behind the count, there are pageids pointing to the next page and the previous page.
+// ------------------------------------------------------------------------------------------------------------------
+// |--count(4 bytes)--|--next pageid(4 bytes)--|--prev pageid(4 bytes)--|--runs of entries (variable size)--|--...--|
+// ------------------------------------------------------------------------------------------------------------------
+
+// For each run of entries with the same key in buffer,
+// --------------------------------------------------------------------------------------------
+// |--key(varint)--|--header(varint)--|--overflow pageid(varint, optional)--|--RecordIds--|
+// --------------------------------------------------------------------------------------------
+// The key of the first run is stored as it is (4 bytes). The key of the
+// other runs is stored as the difference from the key of the previous run.
+// header is (# RecordIds in the run << 1 | 1 if the run has overflow pages).
+// Each RecordId is stored as the difference from the previous RecordId of
+// the run (the first one from (0, 0)): the zigzag-encoded pid difference
+// as a varint, followed by the sid as a varint. When the pid does not
+// change, the zigzag-encoded sid difference is stored instead of the sid.
+
+// For each overflow node,
+// ---------------------------------------------------------------------------------
+// |--count(4 bytes)--|--pageid(4 bytes)--|--RecordIds (same encoding as above)--|
+// ---------------------------------------------------------------------------------
+
+// the size of the count and the next pageid in front of an overflow node
+static const int NODE_HEADER_SIZE = sizeof(int) + sizeof(PageId);
+
+// the size of the count and the next and previous pageids in front of a leaf node
+static const int LEAF_HEADER_SIZE = sizeof(int) + 2 * sizeof(PageId);
+
+// the largest # bytes taken by a 32-bit varint
+static const int MAX_VARINT_SIZE = 5;
+
+// # bytes taken by v as a varint (7 bits per byte)
+static int varintSize(unsigned v)
+{
+	int n = 1;
+	while (v >= 0x80) { v >>= 7; n++; }
+	return n;
+}
+
+static void putVarint(char*& p, unsigned v)
+{
+	while (v >= 0x80) {
+		*p++ = (char)(v | 0x80);
+		v >>= 7;
+	}
+	*p++ = (char)v;
+}
+
+static unsigned getVarint(const char*& p)
+{
+	unsigned v = 0;
+	for (int shift = 0; shift < 35; shift += 7) {
+		unsigned char c = (unsigned char)*p++;
+		v |= (unsigned)(c & 0x7f) << shift;
+		if (!(c & 0x80)) break;
+	}
+	return v;
+}
+
+// map signed differences to unsigned values so that small negative
+// differences also take few bytes
+static unsigned zigzag(int v)
+{
+	return ((unsigned)v << 1) ^ (unsigned)(v >> 31);
+}
+
+static int unzigzag(unsigned v)
+{
+	return (int)(v >> 1) ^ -(int)(v & 1);
+}
+
+// # bytes taken by rid when stored behind prev
+static int ridSize(const RecordId& prev, const RecordId& rid)
+{
+	if (rid.pid == prev.pid)
+		return varintSize(0) + varintSize(zigzag(rid.sid - prev.sid));
+	return varintSize(zigzag(rid.pid - prev.pid)) + varintSize(rid.sid);
+}
+
+static void putRid(char*& p, RecordId& prev, const RecordId& rid)
+{
+	putVarint(p, zigzag(rid.pid - prev.pid));
+	if (rid.pid == prev.pid)
+		putVarint(p, zigzag(rid.sid - prev.sid));
+	else
+		putVarint(p, rid.sid);
+	prev = rid;
+}
+
+static void getRid(const char*& p, RecordId& prev, RecordId& rid)
+{
+	rid.pid = prev.pid + unzigzag(getVarint(p));
+	if (rid.pid == prev.pid)
+		rid.sid = prev.sid + unzigzag(getVarint(p));
+	else
+		rid.sid = getVarint(p);
+	prev = rid;
+}
+
+/*
+ * Read the content of the node from the page pid in the PageFile pf.
+ * @param pid[IN] the PageId to read
+ * @param pf[IN] PageFile to read from
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTLeafNode::read(PageId pid, const PageFile& pf)
+{
+	RC rc;
+	// the zeroed tail keeps the decoder inside the buffer on a corrupted page
+	char buffer[PageFile::PAGE_SIZE + 2 * MAX_VARINT_SIZE];
+	if ((rc = pf.read(pid, buffer)) < 0)
+		return rc;
+	memset(buffer + PageFile::PAGE_SIZE, 0, 2 * MAX_VARINT_SIZE);
+
+	int count;
+	memcpy(&count, buffer, sizeof(count));
+	memcpy(&next, buffer+sizeof(count), sizeof(next));
+	memcpy(&prev, buffer+sizeof(count)+sizeof(next), sizeof(prev));
+	keys.clear();
+	rids.clear();
+	overflows.clear();
+
+	const char* p = buffer + LEAF_HEADER_SIZE;
+	const char* end = buffer + PageFile::PAGE_SIZE;
+	while ((int)keys.size() < count) {
+		if (p + sizeof(int) > end)
+			return RC_INVALID_FILE_FORMAT;
+		int key;
+		if (keys.empty()) {
+			memcpy(&key, p, sizeof(key));
+			p += sizeof(key);
+		} else
+			key = (int)((unsigned)keys.back() + getVarint(p));
+		unsigned header = getVarint(p);
+		PageId overflow = (header & 1) ? (PageId)getVarint(p) : -1;
+
+		RecordId prev = { 0, 0 };
+		RecordId rid;
+		for (unsigned i = 0; i < (header >> 1); i++) {
+			if (p >= end)
+				return RC_INVALID_FILE_FORMAT;
+			getRid(p, prev, rid);
+			keys.push_back(key);
+			rids.push_back(rid);
+			overflows.push_back(overflow);
+		}
+		if (p > end)
+			return RC_INVALID_FILE_FORMAT;
+	}
+	size = p - buffer;
+	return 0;
+}
+    
+/*
+ * Write the content of the node to the page pid in the PageFile pf.
+ * @param pid[IN] the PageId to write to
+ * @param pf[IN] PageFile to write to
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTLeafNode::write(PageId pid, PageFile& pf)
+{
+	char buffer[PageFile::PAGE_SIZE];
+	if (size > PageFile::PAGE_SIZE)
+		return RC_NODE_FULL;
+
+	memset(buffer, 0, sizeof(buffer));
+	int count = keys.size();
+	memcpy(buffer, &count, sizeof(count));
+	memcpy(buffer+sizeof(count), &next, sizeof(next));
+	memcpy(buffer+sizeof(count)+sizeof(next), &prev, sizeof(prev));
+
+	char* p = buffer + LEAF_HEADER_SIZE;
+	for (int begin = 0, end; begin < count; begin = end) {
+		findRun(begin, begin, end);
+		if (begin == 0) {
+			memcpy(p, &keys[begin], sizeof(int));
+			p += sizeof(int);
+		} else
+			putVarint(p, (unsigned)keys[begin] - (unsigned)keys[begin-1]);
+		putVarint(p, ((unsigned)(end - begin) << 1) | (overflows[begin] != -1));
+		if (overflows[begin] != -1)
+			putVarint(p, overflows[begin]);
+
+		RecordId prev = { 0, 0 };
+		for (int i = begin; i < end; i++)
+			putRid(p, prev, rids[i]);
+	}
+	return pf.write(pid, buffer);
+}
+
+/*
+ * Return the number of keys stored in the node.
+ * @return the number of keys in the node
+ */
+int BTLeafNode::getKeyCount()
+{
+	return keys.size();
+}
+
+/*
+ * Insert a (key, rid) pair to the node.
+ * @param key[IN] the key to insert
+ * @param rid[IN] the RecordId to insert
+ * @return 0 if successful. Return an error code if the node is full.
+ */
+RC BTLeafNode::insert(int key, const RecordId& rid)
+{
+	int eid = insertEntry(key, rid);
+	if (size > PageFile::PAGE_SIZE) {
+		removeEntry(eid);
+		return RC_NODE_FULL;
+	}
+	return 0;
+}
+
+/*
+ * Insert the (key, rid) pair to the node
+ * and split the node half and half with sibling.
+ * The split point is always between two runs, so that all entries
+ * with the same key stay in the same node.
+ * The first key of the sibling node is returned in siblingKey.
+ * @param key[IN] the key to insert.
+ * @param rid[IN] the RecordId to insert.
+ * @param sibling[IN] the sibling node to split with. This node MUST be EMPTY when this function is called.
+ * @param siblingKey[OUT] the first key in the sibling node after split.
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTLeafNode::insertAndSplit(int key, const RecordId& rid, 
+                              BTLeafNode& sibling, int& siblingKey)
+{
+	int eid = insertEntry(key, rid);
+	int count = keys.size();
+
+	// find the run boundary that splits the encoded bytes most evenly
+	int split = -1;
+	int best = 0;
+	int left = LEAF_HEADER_SIZE;
+	for (int begin = 0, end; begin < count; begin = end) {
+		findRun(begin, begin, end);
+		if (begin > 0) {
+			// the first key of the sibling is stored as it is
+			int right = size - left + LEAF_HEADER_SIZE - keySize(begin) + sizeof(int);
+			int diff = (left > right) ? left - right : right - left;
+			if (left <= PageFile::PAGE_SIZE && right <= PageFile::PAGE_SIZE &&
+			    (split == -1 || diff < best)) {
+				split = begin;
+				best = diff;
+			}
+		}
+		left += runSize(begin, end);
+	}
+	if (split == -1) {
+		// a single run cannot be split
+		removeEntry(eid);
+		return RC_NODE_FULL;
+	}
+
+	// move the runs behind the split point to the sibling
+	sibling.keys.assign(keys.begin()+split, keys.end());
+	sibling.rids.assign(rids.begin()+split, rids.end());
+	sibling.overflows.assign(overflows.begin()+split, overflows.end());
+	sibling.size = sibling.computeSize();
+	keys.resize(split);
+	rids.resize(split);
+	overflows.resize(split);
+	size = computeSize();
+
+	siblingKey = sibling.keys[0];
+	return 0;
+}
+
+/**
+ * If searchKey exists in the node, set eid to the index entry
+ * with searchKey and return 0. If not, set eid to the index entry
+ * immediately after the largest index key that is smaller than searchKey,
+ * and return the error code RC_NO_SUCH_RECORD.
+ * Remember that keys inside a B+tree node are always kept sorted.
+ * @param searchKey[IN] the key to search for.
+ * @param eid[OUT] the index entry number with searchKey or immediately
+                   behind the largest key smaller than searchKey.
+ * @return 0 if searchKey is found. Otherwise return an error code.
+ */
+RC BTLeafNode::locate(int searchKey, int& eid)
+{
+	// binary search for the first entry not smaller than searchKey
+	int low = 0, high = keys.size();
+	while (low < high) {
+		int mid = low + (high - low) / 2;
+		if (keys[mid] < searchKey)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	eid = low;
+
+	if (eid < (int)keys.size() && keys[eid] == searchKey)
+		return 0;
+	return RC_NO_SUCH_RECORD;
+}
+
+/*
+ * Read the (key, rid) pair from the eid entry.
+ * @param eid[IN] the entry number to read the (key, rid) pair from
+ * @param key[OUT] the key from the entry
+ * @param rid[OUT] the RecordId from the entry
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTLeafNode::readEntry(int eid, int& key, RecordId& rid)
+{
+	if (eid < 0 || eid >= (int)keys.size())return RC_END_OF_TREE;
+	key = keys[eid];
+	rid = rids[eid];
+	return 0;
+}
+
+/*
+ * Return the first overflow page of the run that the eid entry belongs to.
+ * @param eid[IN] an entry of the run
+ * @return the PageId of the first overflow page. -1 if there is none
+ */
+PageId BTLeafNode::getOverflowPtr(int eid)
+{
+	if (eid < 0 || eid >= (int)keys.size())return -1;
+	return overflows[eid];
+}
+
+/*
+ * Set the first overflow page of the run that the eid entry belongs to.
+ * @param eid[IN] an entry of the run
+ * @param pid[IN] the PageId of the first overflow page
+ * @return 0 if successful. RC_NODE_FULL if the pointer does not fit in the node.
+ */
+RC BTLeafNode::setOverflowPtr(int eid, PageId pid)
+{
+	if (eid < 0 || eid >= (int)keys.size())return RC_END_OF_TREE;
+
+	int begin, end;
+	findRun(eid, begin, end);
+	int oldSize = runSize(begin, end);
+	PageId oldPid = overflows[begin];
+	for (int i = begin; i < end; i++)
+		overflows[i] = pid;
+	size += runSize(begin, end) - oldSize;
+
+	// the pointer does not fit in the node. undo the change
+	if (size > PageFile::PAGE_SIZE) {
+		setOverflowPtr(eid, oldPid);
+		return RC_NODE_FULL;
+	}
+	return 0;
+}
+
+/*
+ * Return the pid of the next slibling node.
+ * @return the PageId of the next sibling node 
+ */
+PageId BTLeafNode::getNextNodePtr()
+{
+	return next;
+}
+
+/*
+ * Set the pid of the next slibling node.
+ * @param pid[IN] the PageId of the next sibling node 
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTLeafNode::setNextNodePtr(PageId pid)
+{
+	next = pid;
+	return 0;
+}
+
+/*
+ * Return the pid of the previous slibling node.
+ * @return the PageId of the previous sibling node 
+ */
+PageId BTLeafNode::getPrevNodePtr()
+{
+	return prev;
+}
+
+/*
+ * Set the pid of the previous slibling node.
+ * @param pid[IN] the PageId of the previous sibling node 
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTLeafNode::setPrevNodePtr(PageId pid)
+{
+	prev = pid;
+	return 0;
+}
+
+ BTLeafNode::BTLeafNode()
+{
+	next = -1;
+	prev = -1;
+	size = LEAF_HEADER_SIZE;
+}
+
+/*
+ * Insert the (key, rid) pair behind the other entries with the same key,
+ * without checking the size of the node.
+ * @return the entry number of the new entry
+ */
+int BTLeafNode::insertEntry(int key, const RecordId& rid)
+{
+	int eid;
+	int begin, end;
+	int oldSize = 0;
+	PageId overflow = -1;
+	if (locate(key, eid) == 0) {
+		findRun(eid, begin, end);
+		oldSize = runSize(begin, end);
+		overflow = overflows[begin];
+	} else {
+		// a new run changes the key difference of the run behind it
+		begin = end = eid;
+		if (eid < (int)keys.size())
+			oldSize = keySize(eid);
+	}
+
+	keys.insert(keys.begin()+end, key);
+	rids.insert(rids.begin()+end, rid);
+	overflows.insert(overflows.begin()+end, overflow);
+	size += runSize(begin, end+1) - oldSize;
+	if (begin == end && end+1 < (int)keys.size())
+		size += keySize(end+1);
+	return end;
+}
+
+/*
+ * Remove the eid entry from the node.
+ */
+void BTLeafNode::removeEntry(int eid)
+{
+	int begin, end;
+	findRun(eid, begin, end);
+	int oldSize = runSize(begin, end);
+	bool last = (end - begin == 1);
+	if (last && end < (int)keys.size())
+		oldSize += keySize(end);
+
+	keys.erase(keys.begin()+eid);
+	rids.erase(rids.begin()+eid);
+	overflows.erase(overflows.begin()+eid);
+	size += runSize(begin, end-1) - oldSize;
+	// the run behind a removed run is now stored against another key
+	if (last && begin < (int)keys.size())
+		size += keySize(begin);
+}
+
+/*
+ * Find the run of entries [begin, end) with the same key as the eid entry.
+ */
+void BTLeafNode::findRun(int eid, int& begin, int& end) const
+{
+	begin = end = eid;
+	while (begin > 0 && keys[begin-1] == keys[eid])
+		begin--;
+	while (end < (int)keys.size() && keys[end] == keys[eid])
+		end++;
+}
+
+/*
+ * Return the encoded size of the run of entries [begin, end).
+ */
+int BTLeafNode::runSize(int begin, int end) const
+{
+	if (begin >= end)
+		return 0;
+
+	int n = keySize(begin) + varintSize((unsigned)(end - begin) << 1);
+	if (overflows[begin] != -1)
+		n += varintSize(overflows[begin]);
+	RecordId prev = { 0, 0 };
+	for (int i = begin; i < end; i++) {
+		n += ridSize(prev, rids[i]);
+		prev = rids[i];
+	}
+	return n;
+}
+
+/*
+ * Return the encoded size of the key of the run starting at the eid entry.
+ */
+int BTLeafNode::keySize(int eid) const
+{
+	if (eid == 0)
+		return sizeof(int);
+	return varintSize((unsigned)keys[eid] - (unsigned)keys[eid-1]);
+}
+
+/*
+ * Return the encoded size of the node.
+ */
+int BTLeafNode::computeSize() const
+{
+	int n = LEAF_HEADER_SIZE;
+	for (int begin = 0, end; begin < (int)keys.size(); begin = end) {
+		findRun(begin, begin, end);
+		n += runSize(begin, end);
+	}
+	return n;
+}
+
+BTOverflowNode::BTOverflowNode()
+{
+	next = -1;
+	size = NODE_HEADER_SIZE;
+}
+
+/*
+ * Read the content of the node from the page pid in the PageFile pf.
+ * @param pid[IN] the PageId to read
+ * @param pf[IN] PageFile to read from
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTOverflowNode::read(PageId pid, const PageFile& pf)
+{
+	RC rc;
+	// the zeroed tail keeps the decoder inside the buffer on a corrupted page
+	char buffer[PageFile::PAGE_SIZE + 2 * MAX_VARINT_SIZE];
+	if ((rc = pf.read(pid, buffer)) < 0)
+		return rc;
+	memset(buffer + PageFile::PAGE_SIZE, 0, 2 * MAX_VARINT_SIZE);
+
+	int count;
+	memcpy(&count, buffer, sizeof(count));
+	memcpy(&next, buffer+sizeof(count), sizeof(next));
+	rids.clear();
+
+	const char* p = buffer + NODE_HEADER_SIZE;
+	RecordId prev = { 0, 0 };
+	RecordId rid;
+	for (int i = 0; i < count; i++) {
+		if (p >= buffer + PageFile::PAGE_SIZE)
+			return RC_INVALID_FILE_FORMAT;
+		getRid(p, prev, rid);
+		rids.push_back(rid);
+	}
+	if (p > buffer + PageFile::PAGE_SIZE)
+		return RC_INVALID_FILE_FORMAT;
+	size = p - buffer;
+	return 0;
+}
+
+/*
+ * Write the content of the node to the page pid in the PageFile pf.
+ * @param pid[IN] the PageId to write to
+ * @param pf[IN] PageFile to write to
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTOverflowNode::write(PageId pid, PageFile& pf)
+{
+	char buffer[PageFile::PAGE_SIZE];
+	memset(buffer, 0, sizeof(buffer));
+	int count = rids.size();
+	memcpy(buffer, &count, sizeof(count));
+	memcpy(buffer+sizeof(count), &next, sizeof(next));
+
+	char* p = buffer + NODE_HEADER_SIZE;
+	RecordId prev = { 0, 0 };
+	for (int i = 0; i < count; i++)
+		putRid(p, prev, rids[i]);
+	return pf.write(pid, buffer);
+}
+
+/*
+ * Append a RecordId to the node.
+ * @param rid[IN] the RecordId to append
+ * @return 0 if successful. Return an error code if the node is full.
+ */
+RC BTOverflowNode::insert(const RecordId& rid)
+{
+	RecordId prev = { 0, 0 };
+	if (!rids.empty())
+		prev = rids.back();
+	int n = ridSize(prev, rid);
+	if (size + n > PageFile::PAGE_SIZE)
+		return RC_NODE_FULL;
+
+	rids.push_back(rid);
+	size += n;
+	return 0;
+}
+
+/*
+ * Read the RecordId from the eid entry.
+ * @param eid[IN] the entry number to read
+ * @param rid[OUT] the RecordId from the entry
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTOverflowNode::readEntry(int eid, RecordId& rid)
+{
+	if (eid < 0 || eid >= (int)rids.size())return RC_END_OF_TREE;
+	rid = rids[eid];
+	return 0;
+}
+
+/*
+ * Return the number of RecordIds stored in the node.
+ * @return the number of RecordIds in the node
+ */
+int BTOverflowNode::getCount()
+{
+	return rids.size();
+}
+
+/*
+ * Return the pid of the next overflow page of the run.
+ * @return the PageId of the next overflow page. -1 if there is none
+ */
+PageId BTOverflowNode::getNextNodePtr()
+{
+	return next;
+}
+
+/*
+ * Set the pid of the next overflow page of the run.
+ * @param pid[IN] the PageId of the next overflow page
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTOverflowNode::setNextNodePtr(PageId pid)
+{
+	next = pid;
+	return 0;
+}
+// For each non-leaf node, we create a integer in beginning of the node buffer to record node key count. 
+// Right behind the count, there is a pageid pointing to the first child page.
+// ----------------------------------------------------------------------------------------------------
+// |--count(4 bytes)--|--PageId(varint)---|--node entries(variable size)--|--some unused bytes--|
+// ----------------------------------------------------------------------------------------------------
+
+// For each entry of an non-leaf node,
+// ----------------------------------------
+// |--Key(varint)--|--PageId(varint)--|
+// ----------------------------------------
+// The first key is stored as it is (4 bytes), and the other keys as the
+// difference from the previous key. Each PageId behind a key is stored as
+// the zigzag-encoded difference from the previous PageId, which is small
+// since the children of a node are mostly created one after another.
+BTNonLeafNode::BTNonLeafNode()
+{
+	pids.push_back(-1);
+	size = sizeof(int) + varintSize(zigzag(-1));
+}
+
+/*
+ * Read the content of the node from the page pid in the PageFile pf.
+ * @param pid[IN] the PageId to read
+ * @param pf[IN] PageFile to read from
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTNonLeafNode::read(PageId pid, const PageFile& pf)
+{ 
+	RC rc;
+	// the zeroed tail keeps the decoder inside the buffer on a corrupted page
+	char buffer[PageFile::PAGE_SIZE + 2 * MAX_VARINT_SIZE];
+	if ((rc = pf.read(pid, buffer)) < 0)
+		return rc;
+	memset(buffer + PageFile::PAGE_SIZE, 0, 2 * MAX_VARINT_SIZE);
+
+	int count;
+	memcpy(&count, buffer, sizeof(count));
+	keys.clear();
+	pids.clear();
+
+	const char* p = buffer + sizeof(count);
+	const char* end = buffer + PageFile::PAGE_SIZE;
+	pids.push_back(unzigzag(getVarint(p)));
+	for (int i = 0; i < count; i++) {
+		if (p + sizeof(int) > end)
+			return RC_INVALID_FILE_FORMAT;
+		int key;
+		if (i == 0) {
+			memcpy(&key, p, sizeof(key));
+			p += sizeof(key);
+		} else
+			key = (int)((unsigned)keys.back() + getVarint(p));
+		keys.push_back(key);
+		pids.push_back(pids.back() + unzigzag(getVarint(p)));
+	}
+	if (p > end)
+		return RC_INVALID_FILE_FORMAT;
+	size = p - buffer;
+	return 0;
+}
+    
+/*
+ * Write the content of the node to the page pid in the PageFile pf.
+ * @param pid[IN] the PageId to write to
+ * @param pf[IN] PageFile to write to
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTNonLeafNode::write(PageId pid, PageFile& pf)
+{ 
+	char buffer[PageFile::PAGE_SIZE];
+	if (size > PageFile::PAGE_SIZE)
+		return RC_NODE_FULL;
+
+	memset(buffer, 0, sizeof(buffer));
+	int count = keys.size();
+	memcpy(buffer, &count, sizeof(count));
+
+	char* p = buffer + sizeof(count);
+	putVarint(p, zigzag(pids[0]));
+	for (int i = 0; i < count; i++) {
+		if (i == 0) {
+			memcpy(p, &keys[i], sizeof(int));
+			p += sizeof(int);
+		} else
+			putVarint(p, (unsigned)keys[i] - (unsigned)keys[i-1]);
+		putVarint(p, zigzag(pids[i+1] - pids[i]));
+	}
+	return pf.write(pid, buffer);
+}
+
+/*
+ * Return the number of keys stored in the node.
+ * @return the number of keys in the node
+ */
+int BTNonLeafNode::getKeyCount()
+{
+	return keys.size();
+}
+
+
+/*
+ * Insert a (key, pid) pair to the node.
+ * @param key[IN] the key to insert
+ * @param pid[IN] the PageId to insert
+ * @return 0 if successful. Return an error code if the node is full.
+ */
+RC BTNonLeafNode::insert(int key, PageId pid)
+{
+	int eid = insertEntry(key, pid);
+	if (size > PageFile::PAGE_SIZE) {
+		removeEntry(eid);
+		return RC_NODE_FULL;
+	}
+	return 0; 
+}
+
+/*
+ * Insert the (key, pid) pair to the node
+ * and split the node half and half with sibling.
+ * The middle key after the split is returned in midKey.
+ * @param key[IN] the key to insert
+ * @param pid[IN] the PageId to insert
+ * @param sibling[IN] the sibling node to split with. This node MUST be empty when this function is called.
+ * @param midKey[OUT] the key in the middle after the split. This key should be inserted to the parent node.
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTNonLeafNode::insertAndSplit(int key, PageId pid, BTNonLeafNode& sibling, int& midKey)
+{
+	insertEntry(key, pid);
+	int count = keys.size();
+	if (count < 3)
+		return RC_NODE_FULL;
+
+	// the middle key is the first one that has half of the bytes in front
+	int mid = 1;
+	int left = sizeof(int) + varintSize(zigzag(pids[0])) + entrySize(0);
+	while (mid < count - 2 && left + entrySize(mid) <= size / 2)
+		left += entrySize(mid++);
+
+	midKey = keys[mid];
+	sibling.keys.assign(keys.begin()+mid+1, keys.end());
+	sibling.pids.assign(pids.begin()+mid+1, pids.end());
+	sibling.size = sibling.computeSize();
+	keys.resize(mid);
+	pids.resize(mid+1);
+	size = computeSize();
+	return 0;
+}
+
+/*
+ * Given the searchKey, find the child-node pointer to follow and
+ * output it in pid.
+ * @param searchKey[IN] the searchKey that is being looked up.
+ * @param pid[OUT] the pointer to the child node to follow.
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTNonLeafNode::locateChildPtr(int searchKey, PageId& pid)
+{
+	// binary search for the first key larger than searchKey
+	int low = 0, high = keys.size();
+	while (low < high) {
+		int mid = low + (high - low) / 2;
+		if (keys[mid] > searchKey)
+			high = mid;
+		else
+			low = mid + 1;
+	}
+	pid = pids[low];
+	return 0;
+}
+
+/*
+ * Initialize the root node with (pid1, key, pid2).
+ * @param pid1[IN] the first PageId to insert
+ * @param key[IN] the key that should be inserted between the two PageIds
+ * @param pid2[IN] the PageId to insert behind the key
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTNonLeafNode::initializeRoot(PageId pid1, int key, PageId pid2)
+{
+	keys.assign(1, key);
+	pids.assign(1, pid1);
+	pids.push_back(pid2);
+	size = computeSize();
+	return 0;
+}
+
+/*
+ * Append a (key, pid) pair behind the last entry of the node.
+ * @param key[IN] the key to append
+ * @param pid[IN] the PageId that follows the key
+ * @return 0 if successful. Return an error code if the node is full.
+ */
+RC BTNonLeafNode::append(int key, PageId pid)
+{
+	keys.push_back(key);
+	pids.push_back(pid);
+	int n = entrySize(keys.size()-1);
+	if (size + n > PageFile::PAGE_SIZE) {
+		keys.pop_back();
+		pids.pop_back();
+		return RC_NODE_FULL;
+	}
+	size += n;
+	return 0;
+}
+
+/*
+ * Read the (key, pid) pair from the eid entry.
+ * @param eid[IN] the entry number to read the (key, pid) pair from
+ * @param key[OUT] the key from the entry
+ * @param pid[OUT] the PageId from the entry
+ * @return 0 if successful. Return an error code if there is an error.
+ */
+RC BTNonLeafNode::readEntry(int eid, int& key, PageId& pid)
+{
+	if (eid<0 || eid>=(int)keys.size())return RC_END_OF_TREE;
+	key = keys[eid];
+	pid = pids[eid+1];
+	return 0;
+}
+
+/*
+ * Return the child pointer in front of the first key of the node.
+ * @return the PageId of the first child node
+ */
+PageId BTNonLeafNode::getFirstChildPtr()
+{
+	return pids[0];
+}
+
+/*
+ * Insert the (key, pid) pair behind the keys not larger than key,
+ * without checking the size of the node.
+ * @return the entry number of the new entry
+ */
+int BTNonLeafNode::insertEntry(int key, PageId pid)
+{
+	int eid = 0;
+	while (eid < (int)keys.size() && keys[eid] <= key)
+		eid++;
+
+	// the entry behind the new one is stored against other neighbors now
+	if (eid < (int)keys.size())
+		size -= entrySize(eid);
+	keys.insert(keys.begin()+eid, key);
+	pids.insert(pids.begin()+eid+1, pid);
+	size += entrySize(eid);
+	if (eid+1 < (int)keys.size())
+		size += entrySize(eid+1);
+	return eid;
+}
+
+/*
+ * Remove the eid entry from the node.
+ */
+void BTNonLeafNode::removeEntry(int eid)
+{
+	size -= entrySize(eid);
+	if (eid+1 < (int)keys.size())
+		size -= entrySize(eid+1);
+	keys.erase(keys.begin()+eid);
+	pids.erase(pids.begin()+eid+1);
+	if (eid < (int)keys.size())
+		size += entrySize(eid);
+}
+
+/*
+ * Return the encoded size of the eid entry.
+ */
+int BTNonLeafNode::entrySize(int eid) const
+{
+	int n = (eid == 0) ? (int)sizeof(int)
+	                   : varintSize((unsigned)keys[eid] - (unsigned)keys[eid-1]);
+	return n + varintSize(zigzag(pids[eid+1] - pids[eid]));
+}
+
+/*
+ * Return the encoded size of the node.
+ */
+int BTNonLeafNode::computeSize() const
+{
+	int n = sizeof(int) + varintSize(zigzag(pids[0]));
+	for (int eid = 0; eid < (int)keys.size(); eid++)
+		n += entrySize(eid);
+	return n;
+}
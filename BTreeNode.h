@@ -1,196 +1,340 @@
-/*
- * Copyright (C) 2008 by The Regents of the University of California
- * Redistribution of this file is permitted under the terms of the GNU
- * Public License (GPL).
- *
- * @author Junghoo "John" Cho <cho AT cs.ucla.edu>
- * @date 5/28/2008
- */
-
-#ifndef BTREENODE_H
-#define BTREENODE_H
-
-#include "RecordFile.h"
-#include "PageFile.h"
-#include "Bruinbase.h"
-#include <string.h>
-
-const int MAX_NODE_SIZE = 84;
-const int ENTRY_SIZE = sizeof(int)+sizeof(RecordId);
-const int BUFFER_SIZE = PageFile::PAGE_SIZE;
-const int NONLEAF_ENTRY_SIZE = sizeof(int)+sizeof(PageId);
-
-/**
- * BTLeafNode: The class representing a B+tree leaf node.
- */
-class BTLeafNode {
-  public:
-   /**
-    * Insert the (key, rid) pair to the node.
-    * Remember that all keys inside a B+tree node should be kept sorted.
-    * @param key[IN] the key to insert
-    * @param rid[IN] the RecordId to insert
-    * @return 0 if successful. Return an error code if the node is full.
-    */
-    RC insert(int key, const RecordId& rid);
-
-   /**
-    * Insert the (key, rid) pair to the node
-    * and split the node half and half with sibling.
-    * The first key of the sibling node is returned in siblingKey.
-    * Remember that all keys inside a B+tree node should be kept sorted.
-    * @param key[IN] the key to insert.
-    * @param rid[IN] the RecordId to insert.
-    * @param sibling[IN] the sibling node to split with. This node MUST be EMPTY when this function is called.
-    * @param siblingKey[OUT] the first key in the sibling node after split.
-    * @return 0 if successful. Return an error code if there is an error.
-    */
-    RC insertAndSplit(int key, const RecordId& rid, BTLeafNode& sibling, int& siblingKey);
-
-   /**
-    * If searchKey exists in the node, set eid to the index entry
-    * with searchKey and return 0. If not, set eid to the index entry
-    * immediately after the largest index key that is smaller than searchKey, 
-    * and return the error code RC_NO_SUCH_RECORD.
-    * Remember that keys inside a B+tree node are always kept sorted.
-    * @param searchKey[IN] the key to search for.
-    * @param eid[OUT] the index entry number with searchKey or immediately
-                      behind the largest key smaller than searchKey.
-    * @return 0 if searchKey is found. If not, RC_NO_SEARCH_RECORD.
-    */
-    RC locate(int searchKey, int& eid);
-
-   /**
-    * Read the (key, rid) pair from the eid entry.
-    * @param eid[IN] the entry number to read the (key, rid) pair from
-    * @param key[OUT] the key from the slot
-    * @param rid[OUT] the RecordId from the slot
-    * @return 0 if successful. Return an error code if there is an error.
-    */
-    RC readEntry(int eid, int& key, RecordId& rid);
-
-   /**
-    * Return the pid of the next slibling node.
-    * @return the PageId of the next sibling node 
-    */
-    PageId getNextNodePtr();
-
-
-   /**
-    * Set the next slibling node PageId.
-    * @param pid[IN] the PageId of the next sibling node 
-    * @return 0 if successful. Return an error code if there is an error.
-    */
-    RC setNextNodePtr(PageId pid);
-
-   /**
-    * Return the number of keys stored in the node.
-    * @return the number of keys in the node
-    */
-    int getKeyCount();
- 
-   /**
-    * Read the content of the node from the page pid in the PageFile pf.
-    * @param pid[IN] the PageId to read
-    * @param pf[IN] PageFile to read from
-    * @return 0 if successful. Return an error code if there is an error.
-    */
-    RC read(PageId pid, const PageFile& pf);
-    
-   /**
-    * Write the content of the node to the page pid in the PageFile pf.
-    * @param pid[IN] the PageId to write to
-    * @param pf[IN] PageFile to write to
-    * @return 0 if successful. Return an error code if there is an error.
-    */
-    RC write(PageId pid, PageFile& pf);
-	
-	BTLeafNode();
-  private:
-   /**
-    * The main memory buffer for loading the content of the disk page 
-    * that contains the node.
-    */
-    char buffer[PageFile::PAGE_SIZE];
-}; 
-
-
-/**
- * BTNonLeafNode: The class representing a B+tree nonleaf node.
- */
-class BTNonLeafNode {
-  public:
-   /**
-    * Insert a (key, pid) pair to the node.
-    * Remember that all keys inside a B+tree node should be kept sorted.
-    * @param key[IN] the key to insert
-    * @param pid[IN] the PageId to insert
-    * @return 0 if successful. Return an error code if the node is full.
-    */
-    RC insert(int key, PageId pid);
-
-   /**
-    * Insert the (key, pid) pair to the node
-    * and split the node half and half with sibling.
-    * The sibling node MUST be empty when this function is called.
-    * The middle key after the split is returned in midKey.
-    * Remember that all keys inside a B+tree node should be kept sorted.
-    * @param key[IN] the key to insert
-    * @param pid[IN] the PageId to insert
-    * @param sibling[IN] the sibling node to split with. This node MUST be empty when this function is called.
-    * @param midKey[OUT] the key in the middle after the split. This key should be inserted to the parent node.
-    * @return 0 if successful. Return an error code if there is an error.
-    */
-    RC insertAndSplit(int key, PageId pid, BTNonLeafNode& sibling, int& midKey);
-
-   /**
-    * Given the searchKey, find the child-node pointer to follow and
-    * output it in pid.
-    * Remember that the keys inside a B+tree node are sorted.
-    * @param searchKey[IN] the searchKey that is being looked up.
-    * @param pid[OUT] the pointer to the child node to follow.
-    * @return 0 if successful. Return an error code if there is an error.
-    */
-    RC locateChildPtr(int searchKey, PageId& pid);
-
-   /**
-    * Initialize the root node with (pid1, key, pid2).
-    * @param pid1[IN] the first PageId to insert
-    * @param key[IN] the key that should be inserted between the two PageIds
-    * @param pid2[IN] the PageId to insert behind the key
-    * @return 0 if successful. Return an error code if there is an error.
-    */
-    RC initializeRoot(PageId pid1, int key, PageId pid2);
-
-   /**
-    * Return the number of keys stored in the node.
-    * @return the number of keys in the node
-    */
-    int getKeyCount();
-
-   /**
-    * Read the content of the node from the page pid in the PageFile pf.
-    * @param pid[IN] the PageId to read
-    * @param pf[IN] PageFile to read from
-    * @return 0 if successful. Return an error code if there is an error.
-    */
-    RC read(PageId pid, const PageFile& pf);
-    
-   /**
-    * Write the content of the node to the page pid in the PageFile pf.
-    * @param pid[IN] the PageId to write to
-    * @param pf[IN] PageFile to write to
-    * @return 0 if successful. Return an error code if there is an error.
-    */
-    RC write(PageId pid, PageFile& pf);
-	BTNonLeafNode();
-
-  private:
-   /**
-    * The main memory buffer for loading the content of the disk page 
-    * that contains the node.
-    */
-    char buffer[PageFile::PAGE_SIZE];
-}; 
-
-#endif /* BTREENODE_H */
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ *
+ * @author Junghoo "John" Cho <cho AT cs.ucla.edu>
+ * @date 5/28/2008
+ */
+
+#ifndef BTREENODE_H
+#define BTREENODE_H
+
+#include "RecordFile.h"
+#include "PageFile.h"
+#include "Bruinbase.h"
+#include <string.h>
+#include <vector>
+
+const int MAX_INLINE_RIDS = 64;
+
+/**
+ * BTLeafNode: The class representing a B+tree leaf node.
+ * All entries with the same key form a run, which is stored with the key
+ * once followed by the delta-encoded RecordIds. A run is never split
+ * between two leaf nodes. A run longer than MAX_INLINE_RIDS continues
+ * in a chain of overflow pages (BTOverflowNode) attached to the run.
+ * The node is decoded into memory by read() and encoded by write().
+ */
+class BTLeafNode {
+  public:
+   /**
+    * Insert the (key, rid) pair to the node.
+    * Remember that all keys inside a B+tree node should be kept sorted.
+    * @param key[IN] the key to insert
+    * @param rid[IN] the RecordId to insert
+    * @return 0 if successful. Return an error code if the node is full.
+    */
+    RC insert(int key, const RecordId& rid);
+
+   /**
+    * Insert the (key, rid) pair to the node
+    * and split the node half and half with sibling.
+    * The first key of the sibling node is returned in siblingKey.
+    * Remember that all keys inside a B+tree node should be kept sorted.
+    * @param key[IN] the key to insert.
+    * @param rid[IN] the RecordId to insert.
+    * @param sibling[IN] the sibling node to split with. This node MUST be EMPTY when this function is called.
+    * @param siblingKey[OUT] the first key in the sibling node after split.
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC insertAndSplit(int key, const RecordId& rid, BTLeafNode& sibling, int& siblingKey);
+
+   /**
+    * If searchKey exists in the node, set eid to the index entry
+    * with searchKey and return 0. If not, set eid to the index entry
+    * immediately after the largest index key that is smaller than searchKey, 
+    * and return the error code RC_NO_SUCH_RECORD.
+    * Remember that keys inside a B+tree node are always kept sorted.
+    * @param searchKey[IN] the key to search for.
+    * @param eid[OUT] the index entry number with searchKey or immediately
+                      behind the largest key smaller than searchKey.
+    * @return 0 if searchKey is found. If not, RC_NO_SEARCH_RECORD.
+    */
+    RC locate(int searchKey, int& eid);
+
+   /**
+    * Read the (key, rid) pair from the eid entry.
+    * @param eid[IN] the entry number to read the (key, rid) pair from
+    * @param key[OUT] the key from the slot
+    * @param rid[OUT] the RecordId from the slot
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC readEntry(int eid, int& key, RecordId& rid);
+
+   /**
+    * Return the first overflow page of the run that the eid entry belongs to.
+    * @param eid[IN] an entry of the run
+    * @return the PageId of the first overflow page. -1 if there is none
+    */
+    PageId getOverflowPtr(int eid);
+
+   /**
+    * Set the first overflow page of the run that the eid entry belongs to.
+    * @param eid[IN] an entry of the run
+    * @param pid[IN] the PageId of the first overflow page
+    * @return 0 if successful. RC_NODE_FULL if the pointer does not fit in the node.
+    */
+    RC setOverflowPtr(int eid, PageId pid);
+
+   /**
+    * Return the pid of the next slibling node.
+    * @return the PageId of the next sibling node 
+    */
+    PageId getNextNodePtr();
+
+
+   /**
+    * Set the next slibling node PageId.
+    * @param pid[IN] the PageId of the next sibling node 
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC setNextNodePtr(PageId pid);
+
+   /**
+    * Return the pid of the previous slibling node.
+    * @return the PageId of the previous sibling node. -1 for the first leaf
+    */
+    PageId getPrevNodePtr();
+
+   /**
+    * Set the previous slibling node PageId.
+    * @param pid[IN] the PageId of the previous sibling node 
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC setPrevNodePtr(PageId pid);
+
+   /**
+    * Return the number of keys stored in the node.
+    * @return the number of keys in the node
+    */
+    int getKeyCount();
+ 
+   /**
+    * Read the content of the node from the page pid in the PageFile pf.
+    * @param pid[IN] the PageId to read
+    * @param pf[IN] PageFile to read from
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC read(PageId pid, const PageFile& pf);
+    
+   /**
+    * Write the content of the node to the page pid in the PageFile pf.
+    * @param pid[IN] the PageId to write to
+    * @param pf[IN] PageFile to write to
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC write(PageId pid, PageFile& pf);
+	
+	BTLeafNode();
+  private:
+   /**
+    * The decoded content of the node. Entry i is (keys[i], rids[i]), and
+    * overflows[i] is the first overflow page of the run of keys[i].
+    */
+    std::vector<int>      keys;
+    std::vector<RecordId> rids;
+    std::vector<PageId>   overflows;
+    PageId next;
+    PageId prev;
+    int    size;  // the size of the node when encoded in a page
+
+    int  insertEntry(int key, const RecordId& rid);
+    void removeEntry(int eid);
+    void findRun(int eid, int& begin, int& end) const;
+    int  runSize(int begin, int end) const;
+    int  keySize(int eid) const;
+    int  computeSize() const;
+}; 
+
+/**
+ * BTOverflowNode: The class representing an overflow page that holds
+ * the RecordIds of a long run of duplicate keys.
+ * Overflow pages of a run are chained by their next pointers.
+ */
+class BTOverflowNode {
+  public:
+   /**
+    * Append a RecordId to the node.
+    * @param rid[IN] the RecordId to append
+    * @return 0 if successful. Return an error code if the node is full.
+    */
+    RC insert(const RecordId& rid);
+
+   /**
+    * Read the RecordId from the eid entry.
+    * @param eid[IN] the entry number to read
+    * @param rid[OUT] the RecordId from the entry
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC readEntry(int eid, RecordId& rid);
+
+   /**
+    * Return the number of RecordIds stored in the node.
+    * @return the number of RecordIds in the node
+    */
+    int getCount();
+
+   /**
+    * Return the pid of the next overflow page of the run.
+    * @return the PageId of the next overflow page. -1 if there is none
+    */
+    PageId getNextNodePtr();
+
+   /**
+    * Set the pid of the next overflow page of the run.
+    * @param pid[IN] the PageId of the next overflow page
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC setNextNodePtr(PageId pid);
+
+   /**
+    * Read the content of the node from the page pid in the PageFile pf.
+    * @param pid[IN] the PageId to read
+    * @param pf[IN] PageFile to read from
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC read(PageId pid, const PageFile& pf);
+
+   /**
+    * Write the content of the node to the page pid in the PageFile pf.
+    * @param pid[IN] the PageId to write to
+    * @param pf[IN] PageFile to write to
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC write(PageId pid, PageFile& pf);
+
+	BTOverflowNode();
+  private:
+    std::vector<RecordId> rids;
+    PageId next;
+    int    size;  // the size of the node when encoded in a page
+};
+
+
+/**
+ * BTNonLeafNode: The class representing a B+tree nonleaf node.
+ * Keys and child pointers are delta encoded, so the number of entries
+ * that fit in a node depends on the bytes they take, not on a constant.
+ * The node is decoded into memory by read() and encoded by write().
+ */
+class BTNonLeafNode {
+  public:
+   /**
+    * Insert a (key, pid) pair to the node.
+    * Remember that all keys inside a B+tree node should be kept sorted.
+    * @param key[IN] the key to insert
+    * @param pid[IN] the PageId to insert
+    * @return 0 if successful. Return an error code if the node is full.
+    */
+    RC insert(int key, PageId pid);
+
+   /**
+    * Insert the (key, pid) pair to the node
+    * and split the node half and half with sibling.
+    * The sibling node MUST be empty when this function is called.
+    * The middle key after the split is returned in midKey.
+    * Remember that all keys inside a B+tree node should be kept sorted.
+    * @param key[IN] the key to insert
+    * @param pid[IN] the PageId to insert
+    * @param sibling[IN] the sibling node to split with. This node MUST be empty when this function is called.
+    * @param midKey[OUT] the key in the middle after the split. This key should be inserted to the parent node.
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC insertAndSplit(int key, PageId pid, BTNonLeafNode& sibling, int& midKey);
+
+   /**
+    * Given the searchKey, find the child-node pointer to follow and
+    * output it in pid.
+    * Remember that the keys inside a B+tree node are sorted.
+    * @param searchKey[IN] the searchKey that is being looked up.
+    * @param pid[OUT] the pointer to the child node to follow.
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC locateChildPtr(int searchKey, PageId& pid);
+
+   /**
+    * Initialize the root node with (pid1, key, pid2).
+    * @param pid1[IN] the first PageId to insert
+    * @param key[IN] the key that should be inserted between the two PageIds
+    * @param pid2[IN] the PageId to insert behind the key
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC initializeRoot(PageId pid1, int key, PageId pid2);
+
+   /**
+    * Append a (key, pid) pair behind the last entry of the node.
+    * Unlike insert(), the key is not searched for, so the caller MUST
+    * guarantee that key is not smaller than any key in the node.
+    * This is used to build a node from an already sorted entry list.
+    * @param key[IN] the key to append
+    * @param pid[IN] the PageId that follows the key
+    * @return 0 if successful. Return an error code if the node is full.
+    */
+    RC append(int key, PageId pid);
+
+   /**
+    * Read the (key, pid) pair from the eid entry.
+    * The pid is the child pointer that follows the key.
+    * @param eid[IN] the entry number to read the (key, pid) pair from
+    * @param key[OUT] the key from the entry
+    * @param pid[OUT] the PageId from the entry
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC readEntry(int eid, int& key, PageId& pid);
+
+   /**
+    * Return the child pointer in front of the first key of the node.
+    * @return the PageId of the first child node
+    */
+    PageId getFirstChildPtr();
+
+   /**
+    * Return the number of keys stored in the node.
+    * @return the number of keys in the node
+    */
+    int getKeyCount();
+
+   /**
+    * Read the content of the node from the page pid in the PageFile pf.
+    * @param pid[IN] the PageId to read
+    * @param pf[IN] PageFile to read from
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC read(PageId pid, const PageFile& pf);
+    
+   /**
+    * Write the content of the node to the page pid in the PageFile pf.
+    * @param pid[IN] the PageId to write to
+    * @param pf[IN] PageFile to write to
+    * @return 0 if successful. Return an error code if there is an error.
+    */
+    RC write(PageId pid, PageFile& pf);
+	BTNonLeafNode();
+
+  private:
+   /**
+    * The decoded content of the node. keys[i] is the separator between
+    * the children pids[i] and pids[i+1].
+    */
+    std::vector<int>    keys;
+    std::vector<PageId> pids;
+    int size;  // the size of the node when encoded in a page
+
+    int insertEntry(int key, PageId pid);
+    void removeEntry(int eid);
+    int entrySize(int eid) const;
+    int computeSize() const;
+}; 
+
+#endif /* BTREENODE_H */
@@ -0,0 +1,254 @@
+#include "Catalog.h"
+#include <map>
+#include <sys/stat.h>
+
+using namespace std;
+
+// what a file looked like when it was opened. the modification time
+// has nanoseconds, so that a file rewritten to the same size within a
+// second is not taken for the one opened
+struct FileState {
+  ino_t  ino;
+  off_t  size;
+  time_t mtime;
+  long   mtimeNsec;
+
+  bool operator==(const FileState& s) const
+  {
+    return ino == s.ino && size == s.size && mtime == s.mtime &&
+           mtimeNsec == s.mtimeNsec;
+  }
+};
+
+// the open files of a table
+struct CatalogEntry {
+  RecordFile* rf;      // NULL until the table is read
+  FileState   rfState;
+  BTreeIndex* index;   // NULL until the index is read
+  FileState   indexState;
+  vector<BTreeIndex*> scanIndexes;  // more handles of the index, one per
+                                    // thread of a parallel range scan
+  FileState   scanState;
+  HashIndex*  hash;    // NULL until the HashIndex is read
+  FileState   hashState;
+  TableStats* stats;   // NULL until the statistics are read
+  FileState   statsState;
+  int         lastUsed;
+};
+
+static map<string, CatalogEntry> entries;  // the tables by name
+static int useClock = 0;  // ticks on each lookup, for closing the least recently used table
+
+// close the handles of the index of a table kept for parallel scans
+static void closeScanIndexes(CatalogEntry& e)
+{
+  for (unsigned i = 0; i < e.scanIndexes.size(); i++) {
+    e.scanIndexes[i]->close();
+    delete e.scanIndexes[i];
+  }
+  e.scanIndexes.clear();
+}
+
+// the state of a file on disk
+static RC fileState(const string& filename, FileState& state)
+{
+  struct stat statbuf;
+
+  if (::stat(filename.c_str(), &statbuf) < 0) return RC_FILE_OPEN_FAILED;
+  state.ino = statbuf.st_ino;
+  state.size = statbuf.st_size;
+  state.mtime = statbuf.st_mtim.tv_sec;
+  state.mtimeNsec = statbuf.st_mtim.tv_nsec;
+  return 0;
+}
+
+// the entry of a table. another table is closed if too many are open
+static CatalogEntry& entryOf(const string& table)
+{
+  map<string, CatalogEntry>::iterator it = entries.find(table);
+
+  if (it == entries.end()) {
+    if ((int) entries.size() >= Catalog::MAX_TABLES) {
+      map<string, CatalogEntry>::iterator lru = entries.begin();
+      for (it = entries.begin(); it != entries.end(); ++it) {
+        if (it->second.lastUsed < lru->second.lastUsed) lru = it;
+      }
+      Catalog::drop(lru->first);
+    }
+    CatalogEntry e;
+    e.rf = NULL;
+    e.index = NULL;
+    e.hash = NULL;
+    e.stats = NULL;
+    it = entries.insert(make_pair(table, e)).first;
+  }
+  it->second.lastUsed = ++useClock;
+  return it->second;
+}
+
+RC Catalog::getTable(const string& table, RecordFile*& rf)
+{
+  RC        rc;
+  FileState state;
+
+  if ((rc = fileState(table + ".tbl", state)) < 0) {
+    drop(table);
+    return rc;
+  }
+
+  CatalogEntry& e = entryOf(table);
+  if (e.rf != NULL && !(e.rfState == state)) {
+    // the table changed on disk. closing it drops its cached pages
+    e.rf->close();
+    delete e.rf;
+    e.rf = NULL;
+  }
+  if (e.rf == NULL) {
+    e.rf = new RecordFile;
+    if ((rc = e.rf->open(table + ".tbl", 'r')) < 0) {
+      delete e.rf;
+      e.rf = NULL;
+      return rc;
+    }
+    e.rfState = state;
+  }
+  rf = e.rf;
+  return 0;
+}
+
+RC Catalog::getIndex(const string& table, BTreeIndex*& index)
+{
+  RC        rc;
+  FileState state;
+
+  CatalogEntry& e = entryOf(table);
+  rc = fileState(table + ".idx", state);
+  if (e.index != NULL && (rc < 0 || !(e.indexState == state))) {
+    // a BTreeIndex reads its header once, so a changed index gets a new one
+    e.index->close();
+    delete e.index;
+    e.index = NULL;
+  }
+  if (rc < 0) return rc;
+  if (e.index == NULL) {
+    e.index = new BTreeIndex;
+    if ((rc = e.index->open(table + ".idx", 'r')) < 0) {
+      delete e.index;
+      e.index = NULL;
+      return rc;
+    }
+    e.indexState = state;
+  }
+  index = e.index;
+  return 0;
+}
+
+RC Catalog::getScanIndexes(const string& table, int n, vector<BTreeIndex*>& indexes)
+{
+  RC          rc;
+  FileState   state;
+  BTreeIndex* index;
+
+  // the index is checked as in getIndex(), but a changed index is not
+  // opened again here, since the caller still uses the old handle
+  CatalogEntry& e = entryOf(table);
+  if ((rc = fileState(table + ".idx", state)) < 0) return rc;
+  if (e.index == NULL || !(e.indexState == state)) return RC_FILE_OPEN_FAILED;
+  if (!e.scanIndexes.empty() && !(e.scanState == state)) closeScanIndexes(e);
+
+  // only the table scanned last keeps its handles, so that few files
+  // stay open
+  for (map<string, CatalogEntry>::iterator it = entries.begin(); it != entries.end(); ++it) {
+    if (it->first != table) closeScanIndexes(it->second);
+  }
+
+  while ((int) e.scanIndexes.size() < n) {
+    index = new BTreeIndex;
+    if ((rc = index->open(table + ".idx", 'r')) < 0) {
+      delete index;
+      return rc;
+    }
+    e.scanIndexes.push_back(index);
+    e.scanState = state;
+  }
+  indexes.assign(e.scanIndexes.begin(), e.scanIndexes.begin() + n);
+  return 0;
+}
+
+RC Catalog::getHashIndex(const string& table, HashIndex*& hash)
+{
+  RC        rc;
+  FileState state;
+
+  CatalogEntry& e = entryOf(table);
+  rc = fileState(table + ".hidx", state);
+  if (e.hash != NULL && (rc < 0 || !(e.hashState == state))) {
+    e.hash->close();
+    delete e.hash;
+    e.hash = NULL;
+  }
+  if (rc < 0) return rc;
+  if (e.hash == NULL) {
+    e.hash = new HashIndex;
+    if ((rc = e.hash->open(table + ".hidx", 'r')) < 0) {
+      delete e.hash;
+      e.hash = NULL;
+      return rc;
+    }
+    e.hashState = state;
+  }
+  hash = e.hash;
+  return 0;
+}
+
+RC Catalog::getStats(const string& table, const TableStats*& stats)
+{
+  RC        rc;
+  FileState state;
+
+  CatalogEntry& e = entryOf(table);
+  rc = fileState(table + ".stat", state);
+  if (e.stats != NULL && (rc < 0 || !(e.statsState == state))) {
+    delete e.stats;
+    e.stats = NULL;
+  }
+  if (rc < 0) return rc;
+  if (e.stats == NULL) {
+    e.stats = new TableStats;
+    if ((rc = e.stats->read(table)) < 0) {
+      delete e.stats;
+      e.stats = NULL;
+      return rc;
+    }
+    e.statsState = state;
+  }
+  stats = e.stats;
+  return 0;
+}
+
+void Catalog::drop(const string& table)
+{
+  map<string, CatalogEntry>::iterator it = entries.find(table);
+
+  if (it == entries.end()) return;
+  if (it->second.rf != NULL) {
+    it->second.rf->close();
+    delete it->second.rf;
+  }
+  if (it->second.index != NULL) {
+    it->second.index->close();
+    delete it->second.index;
+  }
+  closeScanIndexes(it->second);
+  if (it->second.hash != NULL) {
+    it->second.hash->close();
+    delete it->second.hash;
+  }
+  delete it->second.stats;
+  entries.erase(it);
+}
+
+void Catalog::dropAll()
+{
+  while (!entries.empty()) drop(entries.begin()->first);
+}
@@ -0,0 +1,96 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <string>
+#include <vector>
+#include "Bruinbase.h"
+#include "RecordFile.h"
+#include "BTreeIndex.h"
+#include "HashIndex.h"
+#include "TableStats.h"
+
+/**
+ * Keeps the RecordFile, the BTreeIndex and the HashIndex of the tables
+ * read by queries open for the rest of the session, so that a query
+ * does not open the files, read the last table page and the index
+ * headers again, and the pages of the files stay in the read cache of
+ * PageFile between queries. The TableStats of a table are kept in
+ * memory the same way, so that a query is planned without reading
+ * <table>.stat.
+ *
+ * Each lookup checks the files with a stat() call, and a file that was
+ * replaced or changed size or modification time since it was opened is
+ * closed and opened again. A statement that writes a table calls drop()
+ * first, so that no stale page of the table stays in the read cache.
+ * At most MAX_TABLES tables are kept open, and the table used least
+ * recently is closed to open another one.
+ */
+class Catalog {
+ public:
+  // # tables kept open at most
+  static const int MAX_TABLES = 32;
+
+  /**
+   * get the RecordFile of <table>.tbl, opened in read mode.
+   * @param table[IN] the table name
+   * @param rf[OUT] the open RecordFile, owned by the Catalog
+   * @return error code. 0 if no error (RC_FILE_OPEN_FAILED if the table
+   *         does not exist)
+   */
+  static RC getTable(const std::string& table, RecordFile*& rf);
+
+  /**
+   * get the BTreeIndex of <table>.idx, opened in read mode.
+   * @param table[IN] the table name
+   * @param index[OUT] the open BTreeIndex, owned by the Catalog
+   * @return error code. 0 if no error (RC_FILE_OPEN_FAILED if the table
+   *         has no BTreeIndex)
+   */
+  static RC getIndex(const std::string& table, BTreeIndex*& index);
+
+  /**
+   * get n more handles of the BTreeIndex of <table>.idx, one for each
+   * thread of a parallel range scan, since a BTreeIndex caches the last
+   * node it read. the handles are kept for the next scan of the table,
+   * and are closed when the table of another parallel scan asks for its
+   * handles.
+   * @param table[IN] the table name
+   * @param n[IN] # handles
+   * @param indexes[OUT] the open handles, owned by the Catalog
+   * @return error code. 0 if no error (RC_FILE_OPEN_FAILED if the table
+   *         has no BTreeIndex)
+   */
+  static RC getScanIndexes(const std::string& table, int n,
+                           std::vector<BTreeIndex*>& indexes);
+
+  /**
+   * get the HashIndex of <table>.hidx, opened in read mode.
+   * @param table[IN] the table name
+   * @param hash[OUT] the open HashIndex, owned by the Catalog
+   * @return error code. 0 if no error (RC_FILE_OPEN_FAILED if the table
+   *         has no HashIndex)
+   */
+  static RC getHashIndex(const std::string& table, HashIndex*& hash);
+
+  /**
+   * get the TableStats of a table, read from <table>.stat.
+   * @param table[IN] the table name
+   * @param stats[OUT] the statistics, owned by the Catalog
+   * @return error code. 0 if no error (RC_FILE_OPEN_FAILED if the table
+   *         has not been analyzed)
+   */
+  static RC getStats(const std::string& table, const TableStats*& stats);
+
+  /**
+   * close the files of a table, before they are written.
+   * @param table[IN] the table name
+   */
+  static void drop(const std::string& table);
+
+  /**
+   * close the files of all tables, at the end of the session.
+   */
+  static void dropAll();
+};
+
+#endif /* CATALOG_H */
@@ -0,0 +1,252 @@
+#include "HashAggregate.h"
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+using namespace std;
+
+// # slots of a new hash table
+static const int INITIAL_SLOTS = 1024;
+
+// the size of a block of the arena
+static const int ARENA_BLOCK = 65536;
+
+// # bits of the hash that choose a partition, and # times a group can
+// be partitioned before the bits of the hash run out
+static const int PARTITION_BITS = 4;
+static const int MAX_LEVEL = 32 / PARTITION_BITS;
+
+// A page of a partition holds groups back to back after a header.
+// ------------------------------------------------------------------------
+// |--# bytes used in the page--|--count--|--length--|--value--|--count--|...
+// ------------------------------------------------------------------------
+static const int RECORD_HEADER_SIZE = 2 * sizeof(int);
+
+// the FNV-1a hash of a value
+static unsigned hashValue(const char* value, int len)
+{
+  unsigned h = 2166136261u;
+  for (int i = 0; i < len; i++) {
+    h = (h ^ (unsigned char) value[i]) * 16777619u;
+  }
+  return h;
+}
+
+// the slot of a hash in the table. the high bits of the hash choose the
+// partition, so they are mixed into the low bits that choose the slot
+static unsigned slotOf(unsigned hash, unsigned mask)
+{
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bu;
+  hash ^= hash >> 13;
+  return hash & mask;
+}
+
+HashAggregate::HashAggregate(const string& name, int level)
+  : slots(INITIAL_SLOTS)
+{
+  this->name = name;
+  this->level = level;
+  error = 0;
+  used = 0;
+  arenaUsed = ARENA_BLOCK;  // the first value starts a block
+  memory = INITIAL_SLOTS * sizeof(Slot);
+  spilling = false;
+  for (int p = 0; p < PARTITIONS; p++) {
+    parts[p] = NULL;
+    pages[p] = NULL;
+    pageUsed[p] = 0;
+  }
+  next = 0;
+  part = -1;
+  child = NULL;
+}
+
+HashAggregate::~HashAggregate()
+{
+  char suffix[16];
+
+  delete child;
+  for (unsigned i = 0; i < arena.size(); i++) delete [] arena[i];
+  for (int p = 0; p < PARTITIONS; p++) {
+    if (parts[p] == NULL) continue;
+    sprintf(suffix, ".%d", p);
+    parts[p]->close();
+    ::unlink((name + suffix).c_str());
+    delete parts[p];
+    delete [] pages[p];
+  }
+}
+
+RC HashAggregate::add(const char* value, int len, int count)
+{
+  RC rc = 0;
+  unsigned hash = hashValue(value, len);
+  unsigned mask = slots.size() - 1;
+  unsigned i;
+
+  for (i = slotOf(hash, mask); slots[i].value != NULL; i = (i + 1) & mask) {
+    Slot& s = slots[i];
+    if (s.hash == hash && s.len == len && memcmp(s.value, value, len) == 0) {
+      s.count += count;
+      return 0;
+    }
+  }
+
+  // a new group. once the budget is full, the new groups go to the partitions
+  long extra = 0;
+  if (arenaUsed + len > ARENA_BLOCK) extra += ARENA_BLOCK;
+  if ((used + 1) * 2 > (int) slots.size()) extra += slots.size() * sizeof(Slot);
+  if (spilled() || (memory + extra > MEMORY_BUDGET && level < MAX_LEVEL)) {
+    if ((rc = spill(hash, value, len, count)) < 0 && error == 0) error = rc;
+    return rc;
+  }
+
+  // the table is kept at most half full
+  if ((used + 1) * 2 > (int) slots.size()) {
+    grow();
+    mask = slots.size() - 1;
+    for (i = slotOf(hash, mask); slots[i].value != NULL; i = (i + 1) & mask) ;
+  }
+  slots[i].hash = hash;
+  slots[i].count = count;
+  slots[i].value = copyValue(value, len);
+  slots[i].len = len;
+  used++;
+  return 0;
+}
+
+// copy a value to the arena
+const char* HashAggregate::copyValue(const char* value, int len)
+{
+  if (arenaUsed + len > ARENA_BLOCK) {
+    arena.push_back(new char[len > ARENA_BLOCK ? len : ARENA_BLOCK]);
+    arenaUsed = 0;
+    memory += ARENA_BLOCK;
+  }
+  char* copy = arena.back() + arenaUsed;
+  memcpy(copy, value, len);
+  arenaUsed += len;
+  return copy;
+}
+
+// double the slots of the table, and move the groups to their new slots
+void HashAggregate::grow()
+{
+  vector<Slot> old(slots.size() * 2);
+  old.swap(slots);
+  memory += old.size() * sizeof(Slot);
+
+  unsigned mask = slots.size() - 1;
+  for (unsigned j = 0; j < old.size(); j++) {
+    if (old[j].value == NULL) continue;
+    unsigned i = slotOf(old[j].hash, mask);
+    while (slots[i].value != NULL) i = (i + 1) & mask;
+    slots[i] = old[j];
+  }
+}
+
+// write a group to the partition chosen by the next bits of its hash
+RC HashAggregate::spill(unsigned hash, const char* value, int len, int count)
+{
+  RC   rc;
+  char suffix[16];
+
+  int p = (hash >> (32 - PARTITION_BITS * (level + 1))) & (PARTITIONS - 1);
+  spilling = true;
+  if (parts[p] == NULL) {
+    sprintf(suffix, ".%d", p);
+    parts[p] = new PageFile;
+    pages[p] = new char[PageFile::PAGE_SIZE];
+    pageUsed[p] = sizeof(int);
+    ::unlink((name + suffix).c_str());
+    if ((rc = parts[p]->open(name + suffix, 'w')) < 0) return rc;
+  }
+  if (pageUsed[p] + RECORD_HEADER_SIZE + len > PageFile::PAGE_SIZE &&
+      (rc = flushPage(p)) < 0) return rc;
+  char* record = pages[p] + pageUsed[p];
+  memcpy(record, &count, sizeof(int));
+  memcpy(record + sizeof(int), &len, sizeof(int));
+  memcpy(record + RECORD_HEADER_SIZE, value, len);
+  pageUsed[p] += RECORD_HEADER_SIZE + len;
+  return 0;
+}
+
+// append the page being filled to its partition
+RC HashAggregate::flushPage(int p)
+{
+  RC rc;
+
+  memcpy(pages[p], &pageUsed[p], sizeof(int));
+  if ((rc = parts[p]->write(parts[p]->endPid(), pages[p])) < 0) return rc;
+  pageUsed[p] = sizeof(int);
+  return 0;
+}
+
+RC HashAggregate::finish()
+{
+  RC rc;
+
+  next = 0;
+  part = -1;
+  if (error < 0) return error;
+  if (!spilled()) return 0;
+  for (int p = 0; p < PARTITIONS; p++) {
+    if (parts[p] != NULL && pageUsed[p] > (int) sizeof(int) &&
+        (rc = flushPage(p)) < 0) return rc;
+  }
+  return 0;
+}
+
+// count the groups of the p'th partition with a child HashAggregate
+RC HashAggregate::readPartition(int p)
+{
+  RC   rc;
+  char suffix[16];
+  int  count, len, pageEnd;
+
+  // the groups in memory have been read, and the child gets the budget
+  for (unsigned i = 0; i < arena.size(); i++) delete [] arena[i];
+  arena.clear();
+  vector<Slot>().swap(slots);
+  next = 0;
+
+  sprintf(suffix, ".%d", p);
+  child = new HashAggregate(name + suffix, level + 1);
+  for (PageId pid = 0; pid < parts[p]->endPid(); pid++) {
+    if ((rc = parts[p]->read(pid, pages[p])) < 0) return rc;
+    memcpy(&pageEnd, pages[p], sizeof(int));
+    for (int pos = sizeof(int); pos < pageEnd; pos += RECORD_HEADER_SIZE + len) {
+      memcpy(&count, pages[p] + pos, sizeof(int));
+      memcpy(&len, pages[p] + pos + sizeof(int), sizeof(int));
+      if ((rc = child->add(pages[p] + pos + RECORD_HEADER_SIZE, len, count)) < 0) return rc;
+    }
+  }
+  return child->finish();
+}
+
+RC HashAggregate::readNext(string& value, int& count)
+{
+  RC rc;
+
+  // the groups in memory first
+  for (; next < slots.size(); next++) {
+    if (slots[next].value == NULL) continue;
+    value.assign(slots[next].value, slots[next].len);
+    count = slots[next].count;
+    next++;
+    return 0;
+  }
+
+  // then the groups of each partition
+  for (;;) {
+    if (child != NULL) {
+      if ((rc = child->readNext(value, count)) != RC_END_OF_TREE) return rc;
+      delete child;
+      child = NULL;
+    }
+    if (!spilled() || part + 1 >= PARTITIONS) return RC_END_OF_TREE;
+    part++;
+    if (parts[part] != NULL && (rc = readPartition(part)) < 0) return rc;
+  }
+}
@@ -0,0 +1,114 @@
+#ifndef HASHAGGREGATE_H
+#define HASHAGGREGATE_H
+
+#include <string>
+#include <vector>
+#include "Bruinbase.h"
+#include "PageFile.h"
+
+/**
+ * Counts the tuples of each value for "SELECT value, COUNT(*) ...
+ * GROUP BY value". The groups are kept in an open addressing hash table
+ * with linear probing, and the values of the groups are copied to an
+ * arena of large blocks instead of a string per group.
+ *
+ * When the table and the arena would grow beyond MEMORY_BUDGET bytes,
+ * the groups in memory keep counting, and the tuples of the new groups
+ * are written to PARTITIONS temporary PageFiles, chosen by the hash of
+ * the value. Each partition is counted by another HashAggregate after
+ * the groups in memory are read, with the next bits of the hash to
+ * partition it further if it is still too large.
+ *
+ * The values are given to add(), then finish() is called once, and the
+ * groups are read with readNext().
+ */
+class HashAggregate {
+ public:
+  // # bytes of the hash table and the arena, at most
+  static const int MEMORY_BUDGET = 16 * 1024 * 1024;
+
+  // # partitions the groups beyond MEMORY_BUDGET are written to
+  static const int PARTITIONS = 16;
+
+  /**
+   * @param name[IN] the prefix of the names of the temporary files
+   * @param level[IN] # times the groups have been partitioned
+   */
+  HashAggregate(const std::string& name, int level = 0);
+
+  /**
+   * the arena is freed and the temporary files are removed
+   */
+  ~HashAggregate();
+
+  /**
+   * count a tuple in the group of its value.
+   * @param value[IN] the value of the tuple
+   * @param len[IN] the length of the value
+   * @param count[IN] # tuples to count
+   * @return error code. 0 if no error
+   */
+  RC add(const char* value, int len, int count = 1);
+
+  RC add(const std::string& value) { return add(value.data(), value.size()); }
+
+  /**
+   * end the input, to read the groups with readNext().
+   * @return error code. 0 if no error, or the first error of add()
+   */
+  RC finish();
+
+  /**
+   * read the next group. the groups are read in no particular order.
+   * @param value[OUT] the value of the group
+   * @param count[OUT] # tuples of the group
+   * @return error code. RC_END_OF_TREE after the last group
+   */
+  RC readNext(std::string& value, int& count);
+
+  /**
+   * @return true if some groups were written to temporary files
+   */
+  bool spilled() const { return spilling; }
+
+ private:
+  // a group of the hash table. value is NULL in an empty slot
+  struct Slot {
+    unsigned    hash;
+    int         count;
+    const char* value;
+    int         len;
+  };
+
+  std::string name;  /// the partitions are name.0, name.1, ...
+  int  level;        /// # times the groups have been partitioned
+  RC   error;        /// the first error of add()
+
+  std::vector<Slot> slots;  /// the hash table, a power of 2 slots
+  int  used;                /// # groups in the table
+
+  std::vector<char*> arena;  /// the blocks of the values of the groups
+  int  arenaUsed;            /// # bytes used in the last block
+  long memory;               /// # bytes of the table and the arena
+
+  bool      spilling;            /// the budget is full
+  PageFile* parts[PARTITIONS];   /// the partitions, opened on their first group
+  char*     pages[PARTITIONS];   /// the page of each partition being filled
+  int       pageUsed[PARTITIONS];
+
+  unsigned next;          /// the next slot read by readNext()
+  int      part;          /// the partition read by readNext()
+  HashAggregate* child;   /// counts the groups of partition part
+
+  const char* copyValue(const char* value, int len);
+  void grow();
+  RC spill(unsigned hash, const char* value, int len, int count);
+  RC flushPage(int p);
+  RC readPartition(int p);
+
+  // a HashAggregate owns its arena and files, and is not copied
+  HashAggregate(const HashAggregate&);
+  HashAggregate& operator=(const HashAggregate&);
+};
+
+#endif /* HASHAGGREGATE_H */
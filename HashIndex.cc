@@ -0,0 +1,399 @@
+#include "HashIndex.h"
+#include <string.h>
+#include <cstdio>
+#include <algorithm>
+
+using namespace std;
+
+// The first page of the index file is the header.
+// --------------------------------------------------------------------------------------
+// |--global depth(4 bytes)--|--first directory page(4 bytes)--|--# directory pages(4 bytes)--|
+// --------------------------------------------------------------------------------------
+
+// A directory page is an array of bucket PageIds.
+
+// A bucket page, or an overflow page chained to a bucket,
+// -----------------------------------------------------------------------------------------------
+// |--local depth(4 bytes)--|--count(4 bytes)--|--next overflow page(4 bytes)--|--entries(12 bytes each)--|
+// -----------------------------------------------------------------------------------------------
+
+// # bucket PageIds in a directory page
+static const int DIR_ENTRIES_PER_PAGE = PageFile::PAGE_SIZE / sizeof(PageId);
+
+// size of the bucket page header and # (key, RecordId) entries in a bucket page
+static const int BUCKET_HEADER_SIZE = sizeof(int) + sizeof(int) + sizeof(PageId);
+static const int BUCKET_ENTRY_SIZE = sizeof(int) + sizeof(RecordId);
+static const int BUCKET_SIZE = (PageFile::PAGE_SIZE - BUCKET_HEADER_SIZE) / BUCKET_ENTRY_SIZE;
+
+static int getLocalDepth(const char* page)
+{
+	int depth;
+	memcpy(&depth, page, sizeof(int));
+	return depth;
+}
+
+static void setLocalDepth(char* page, int depth)
+{
+	memcpy(page, &depth, sizeof(int));
+}
+
+static int getCount(const char* page)
+{
+	int count;
+	memcpy(&count, page+sizeof(int), sizeof(int));
+	return count;
+}
+
+static void setCount(char* page, int count)
+{
+	memcpy(page+sizeof(int), &count, sizeof(int));
+}
+
+static PageId getOverflowPtr(const char* page)
+{
+	PageId pid;
+	memcpy(&pid, page+2*sizeof(int), sizeof(PageId));
+	return pid;
+}
+
+static void setOverflowPtr(char* page, PageId pid)
+{
+	memcpy(page+2*sizeof(int), &pid, sizeof(PageId));
+}
+
+static void readEntry(const char* page, int eid, int& key, RecordId& rid)
+{
+	const char* ptr = page + BUCKET_HEADER_SIZE + BUCKET_ENTRY_SIZE*eid;
+	memcpy(&key, ptr, sizeof(int));
+	memcpy(&rid, ptr+sizeof(int), sizeof(RecordId));
+}
+
+static void writeEntry(char* page, int eid, int key, const RecordId& rid)
+{
+	char* ptr = page + BUCKET_HEADER_SIZE + BUCKET_ENTRY_SIZE*eid;
+	memcpy(ptr, &key, sizeof(int));
+	memcpy(ptr+sizeof(int), &rid, sizeof(RecordId));
+}
+
+// initialize an empty bucket page
+static void initBucket(char* page, int depth)
+{
+	memset(page, 0, PageFile::PAGE_SIZE);
+	setLocalDepth(page, depth);
+	setCount(page, 0);
+	setOverflowPtr(page, -1);
+}
+
+HashIndex::HashIndex()
+{
+	mode = 'r';
+	globalDepth = 0;
+	dirPid = -1;
+	dirPages = 0;
+}
+
+/*
+ * Open the index file in read or write mode.
+ * Under 'w' mode, the index file should be created if it does not exist.
+ * @param indexname[IN] the name of the index file
+ * @param mode[IN] 'r' for read, 'w' for write
+ * @return error code. 0 if no error
+ */
+RC HashIndex::open(const string& indexname, char mode)
+{
+	RC rc;
+	char buffer[PageFile::PAGE_SIZE];
+
+	if ((rc = pf.open(indexname, mode)) < 0)
+		return rc;
+	this->mode = mode;
+	directory.clear();
+
+	if (pf.endPid() == 0)
+	{
+		// a new index: the header page and a single empty bucket
+		globalDepth = 0;
+		dirPid = -1;
+		dirPages = 0;
+		memset(buffer, 0, sizeof(buffer));
+		memcpy(buffer, &globalDepth, sizeof(int));
+		memcpy(buffer+sizeof(int), &dirPid, sizeof(PageId));
+		memcpy(buffer+2*sizeof(int), &dirPages, sizeof(int));
+		if ((rc = pf.write(0, buffer)) < 0)
+			return rc;
+		initBucket(buffer, 0);
+		if ((rc = pf.write(1, buffer)) < 0)
+			return rc;
+		directory.push_back(1);
+		return 0;
+	}
+
+	// read the header
+	if ((rc = pf.read(0, buffer)) < 0)
+		return rc;
+	memcpy(&globalDepth, buffer, sizeof(int));
+	memcpy(&dirPid, buffer+sizeof(int), sizeof(PageId));
+	memcpy(&dirPages, buffer+2*sizeof(int), sizeof(int));
+	if (globalDepth < 0 || globalDepth > MAX_GLOBAL_DEPTH || dirPid < 0)
+	{
+		pf.close();
+		return RC_INVALID_FILE_FORMAT;
+	}
+
+	// under 'r' mode, lookup() reads the single directory page it needs.
+	// under 'w' mode, the whole directory is loaded into memory for splits.
+	if (mode != 'w' && mode != 'W')
+		return 0;
+	directory.resize(1 << globalDepth);
+	for (int i = 0; i < (int)directory.size(); i++)
+	{
+		if (i % DIR_ENTRIES_PER_PAGE == 0 &&
+		    (rc = pf.read(dirPid + i / DIR_ENTRIES_PER_PAGE, buffer)) < 0)
+		{
+			pf.close();
+			return rc;
+		}
+		memcpy(&directory[i], buffer + sizeof(PageId)*(i % DIR_ENTRIES_PER_PAGE), sizeof(PageId));
+	}
+	return 0;
+}
+
+/*
+ * Close the index file. Under 'w' mode, the directory is saved first.
+ * @return error code. 0 if no error
+ */
+RC HashIndex::close()
+{
+	RC rc;
+	char buffer[PageFile::PAGE_SIZE];
+
+	if (mode == 'w' || mode == 'W')
+	{
+		// reuse the old directory pages if the directory still fits.
+		// otherwise, save it to new pages at the end of the file.
+		int pages = (directory.size() + DIR_ENTRIES_PER_PAGE - 1) / DIR_ENTRIES_PER_PAGE;
+		if (dirPid < 0 || pages > dirPages)
+		{
+			dirPid = pf.endPid();
+			dirPages = pages;
+		}
+		for (int p = 0; p < pages; p++)
+		{
+			memset(buffer, 0, sizeof(buffer));
+			int n = min((int)directory.size() - p*DIR_ENTRIES_PER_PAGE, DIR_ENTRIES_PER_PAGE);
+			memcpy(buffer, &directory[p*DIR_ENTRIES_PER_PAGE], sizeof(PageId)*n);
+			if ((rc = pf.write(dirPid + p, buffer)) < 0)
+				return rc;
+		}
+
+		memset(buffer, 0, sizeof(buffer));
+		memcpy(buffer, &globalDepth, sizeof(int));
+		memcpy(buffer+sizeof(int), &dirPid, sizeof(PageId));
+		memcpy(buffer+2*sizeof(int), &dirPages, sizeof(int));
+		if ((rc = pf.write(0, buffer)) < 0)
+			return rc;
+	}
+	directory.clear();
+	return pf.close();
+}
+
+/*
+ * Insert (key, RecordId) pair to the index.
+ * @param key[IN] the key for the value inserted into the index
+ * @param rid[IN] the RecordId for the record being inserted into the index
+ * @return error code. 0 if no error
+ */
+RC HashIndex::insert(int key, const RecordId& rid)
+{
+	RC rc;
+	char page[PageFile::PAGE_SIZE];
+	unsigned h = hash(key);
+
+	if (mode != 'w' && mode != 'W')
+		return RC_INVALID_FILE_MODE;
+
+	for (;;)
+	{
+		PageId pid = directory[h & ((1u << globalDepth) - 1)];
+		if ((rc = pf.read(pid, page)) < 0)
+			return rc;
+
+		int count = getCount(page);
+		if (count < BUCKET_SIZE)
+		{
+			writeEntry(page, count, key, rid);
+			setCount(page, count+1);
+			return pf.write(pid, page);
+		}
+
+		// splitting cannot separate entries with the same hash value
+		bool sameHash = true;
+		for (int eid = 0; eid < count && sameHash; eid++)
+		{
+			int k;
+			RecordId r;
+			readEntry(page, eid, k, r);
+			sameHash = (hash(k) == h);
+		}
+		if (sameHash || getLocalDepth(page) >= MAX_GLOBAL_DEPTH)
+			return insertOverflow(pid, page, key, rid);
+
+		// split the bucket, and try again
+		if ((rc = split(pid, page, h)) < 0)
+			return rc;
+	}
+}
+
+/*
+ * Find all RecordIds stored with searchKey.
+ * @param searchKey[IN] the key to find
+ * @param rids[OUT] the RecordIds with searchKey are appended to rids
+ * @return error code. 0 if no error (even if searchKey is not found)
+ */
+RC HashIndex::lookup(int searchKey, vector<RecordId>& rids)
+{
+	RC rc;
+	char page[PageFile::PAGE_SIZE];
+
+	unsigned slot = hash(searchKey) & ((1u << globalDepth) - 1);
+	PageId pid;
+	if (directory.empty())
+	{
+		if ((rc = pf.read(dirPid + slot / DIR_ENTRIES_PER_PAGE, page)) < 0)
+			return rc;
+		memcpy(&pid, page + sizeof(PageId)*(slot % DIR_ENTRIES_PER_PAGE), sizeof(PageId));
+	}
+	else
+		pid = directory[slot];
+
+	while (pid != -1)
+	{
+		if ((rc = pf.read(pid, page)) < 0)
+			return rc;
+		int count = getCount(page);
+		for (int eid = 0; eid < count; eid++)
+		{
+			int key;
+			RecordId rid;
+			readEntry(page, eid, key, rid);
+			if (key == searchKey)
+				rids.push_back(rid);
+		}
+		pid = getOverflowPtr(page);
+	}
+	return 0;
+}
+
+/*
+ * Mix the bits of the key, so that the low bits used by the
+ * directory depend on all bits of the key.
+ */
+unsigned HashIndex::hash(int key)
+{
+	unsigned h = (unsigned)key;
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+/*
+ * Split the full bucket at pid, whose content is in page. h is the hash
+ * value of the key being inserted. The directory is doubled if needed.
+ */
+RC HashIndex::split(PageId pid, char* page, unsigned h)
+{
+	RC rc;
+	int depth = getLocalDepth(page);
+
+	// double the directory. the new half points to the same buckets
+	if (depth == globalDepth)
+	{
+		int size = directory.size();
+		directory.resize(size*2);
+		for (int i = 0; i < size; i++)
+			directory[size+i] = directory[i];
+		globalDepth++;
+	}
+
+	// entries whose hash has the bit 'depth' set move to the new bucket
+	unsigned bit = 1u << depth;
+	char left[PageFile::PAGE_SIZE];
+	char right[PageFile::PAGE_SIZE];
+	initBucket(left, depth+1);
+	initBucket(right, depth+1);
+
+	int count = getCount(page);
+	int leftCount = 0, rightCount = 0;
+	for (int eid = 0; eid < count; eid++)
+	{
+		int key;
+		RecordId rid;
+		readEntry(page, eid, key, rid);
+		if (hash(key) & bit)
+			writeEntry(right, rightCount++, key, rid);
+		else
+			writeEntry(left, leftCount++, key, rid);
+	}
+	setCount(left, leftCount);
+	setCount(right, rightCount);
+
+	// an overflow chain only exists while all entries of the bucket have
+	// the same hash value, so the whole chain follows them to one side
+	if (getOverflowPtr(page) != -1)
+		setOverflowPtr(rightCount > 0 ? right : left, getOverflowPtr(page));
+
+	PageId newPid = pf.endPid();
+	if ((rc = pf.write(pid, left)) < 0)
+		return rc;
+	if ((rc = pf.write(newPid, right)) < 0)
+		return rc;
+
+	// point the directory entries of the new bucket to it
+	unsigned low = h & (bit - 1);
+	for (unsigned i = 0; i < directory.size(); i++)
+	{
+		if ((i & (bit - 1)) == low && (i & bit))
+			directory[i] = newPid;
+	}
+	return 0;
+}
+
+/*
+ * Add (key, rid) to the overflow chain of the full bucket at pid,
+ * whose content is in page.
+ */
+RC HashIndex::insertOverflow(PageId pid, char* page, int key, const RecordId& rid)
+{
+	RC rc;
+
+	// walk to the last page of the chain
+	PageId next;
+	while ((next = getOverflowPtr(page)) != -1)
+	{
+		pid = next;
+		if ((rc = pf.read(pid, page)) < 0)
+			return rc;
+	}
+
+	int count = getCount(page);
+	if (count < BUCKET_SIZE)
+	{
+		writeEntry(page, count, key, rid);
+		setCount(page, count+1);
+		return pf.write(pid, page);
+	}
+
+	// the last page is full as well. chain a new overflow page to it
+	char overflow[PageFile::PAGE_SIZE];
+	initBucket(overflow, getLocalDepth(page));
+	writeEntry(overflow, 0, key, rid);
+	setCount(overflow, 1);
+	PageId newPid = pf.endPid();
+	if ((rc = pf.write(newPid, overflow)) < 0)
+		return rc;
+	setOverflowPtr(page, newPid);
+	return pf.write(pid, page);
+}
@@ -0,0 +1,74 @@
+#ifndef HASHINDEX_H
+#define HASHINDEX_H
+
+#include "Bruinbase.h"
+#include "PageFile.h"
+#include "RecordFile.h"
+#include <string>
+#include <vector>
+
+/**
+ * Implements an extendible hash index for key equality lookups.
+ * The directory maps the low globalDepth bits of the hashed key to a
+ * bucket page. A lookup reads one directory page and one bucket page
+ * (plus overflow pages for keys with more duplicates than fit in a
+ * bucket). Under 'w' mode, the directory is kept in memory.
+ * A full bucket is split in two, doubling the directory when its local
+ * depth reaches the global depth. When all entries of a full bucket
+ * have the same hash value, splitting cannot help and the entry goes
+ * to an overflow page chained to the bucket.
+ */
+class HashIndex {
+ public:
+  // the largest global depth. the directory has at most 2^MAX_GLOBAL_DEPTH entries
+  static const int MAX_GLOBAL_DEPTH = 20;
+
+  HashIndex();
+
+  /**
+   * Open the index file in read or write mode.
+   * Under 'w' mode, the index file should be created if it does not exist.
+   * @param indexname[IN] the name of the index file
+   * @param mode[IN] 'r' for read, 'w' for write
+   * @return error code. 0 if no error
+   */
+  RC open(const std::string& indexname, char mode);
+
+  /**
+   * Close the index file. Under 'w' mode, the directory is saved first.
+   * @return error code. 0 if no error
+   */
+  RC close();
+
+  /**
+   * Insert (key, RecordId) pair to the index.
+   * @param key[IN] the key for the value inserted into the index
+   * @param rid[IN] the RecordId for the record being inserted into the index
+   * @return error code. 0 if no error
+   */
+  RC insert(int key, const RecordId& rid);
+
+  /**
+   * Find all RecordIds stored with searchKey.
+   * @param searchKey[IN] the key to find
+   * @param rids[OUT] the RecordIds with searchKey are appended to rids
+   * @return error code. 0 if no error (even if searchKey is not found)
+   */
+  RC lookup(int searchKey, std::vector<RecordId>& rids);
+
+ private:
+  PageFile pf;           /// the PageFile used to store the buckets and the directory
+  char     mode;         /// the mode the index was opened in
+
+  int      globalDepth;  /// # hash bits used to index the directory
+  PageId   dirPid;       /// the first page of the directory on disk. -1 if not saved yet
+  int      dirPages;     /// # pages reserved for the directory on disk
+  std::vector<PageId> directory;  /// bucket PageId for each directory entry.
+                                 /// empty under 'r' mode
+
+  static unsigned hash(int key);
+  RC split(PageId pid, char* page, unsigned h);
+  RC insertOverflow(PageId pid, char* page, int key, const RecordId& rid);
+};
+
+#endif /* HASHINDEX_H */
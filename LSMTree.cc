@@ -0,0 +1,447 @@
+#include "LSMTree.h"
+#include <string.h>
+#include <cstdio>
+#include <climits>
+#include <unistd.h>
+
+using namespace std;
+
+// The manifest file has a single page listing the runs of the tree.
+// -------------------------------------------------------------------------------------
+// |--run count(4 bytes)--|--next run id(4 bytes)--|--run ids, oldest first(4 bytes each)--|
+// -------------------------------------------------------------------------------------
+
+// Each run file is a sequence of pages with sorted entries. Keys never
+// decrease from one page to the next.
+// ----------------------------------------------------------------------------
+// |--count(4 bytes)--|--entries: key(4 bytes), RecordId(8 bytes)--|--unused--|
+// ----------------------------------------------------------------------------
+
+// read the eid'th entry of a run page
+static void readRunEntry(const char* page, int eid, int& key, RecordId& rid)
+{
+	const char* ptr = page + sizeof(int) + (sizeof(int) + sizeof(RecordId))*eid;
+	memcpy(&key, ptr, sizeof(key));
+	memcpy(&rid, ptr + sizeof(key), sizeof(rid));
+}
+
+// write the eid'th entry of a run page
+static void writeRunEntry(char* page, int eid, int key, const RecordId& rid)
+{
+	char* ptr = page + sizeof(int) + (sizeof(int) + sizeof(RecordId))*eid;
+	memcpy(ptr, &key, sizeof(key));
+	memcpy(ptr + sizeof(key), &rid, sizeof(rid));
+}
+
+LSMTree::LSMTree()
+{
+	mode = 'r';
+	nextRunId = 0;
+}
+
+/*
+ * Open the index in read or write mode.
+ * @param indexname[IN] the name of the manifest file of the index
+ * @param mode[IN] 'r' for read, 'w' for write
+ * @return error code. 0 if no error
+ */
+RC LSMTree::open(const string& indexname, char mode)
+{
+	RC rc;
+	PageFile mf;
+	char buffer[PageFile::PAGE_SIZE];
+
+	if ((rc = mf.open(indexname, mode)) < 0)
+		return rc;
+	name = indexname;
+	this->mode = mode;
+	runIds.clear();
+	runFiles.clear();
+	memtable.clear();
+	nextRunId = 0;
+
+	if (mf.endPid() > 0)
+	{
+		if ((rc = mf.read(0, buffer)) < 0)
+		{
+			mf.close();
+			return rc;
+		}
+		int count;
+		memcpy(&count, buffer, sizeof(int));
+		memcpy(&nextRunId, buffer+sizeof(int), sizeof(int));
+		if (count < 0 || count > MAX_MANIFEST_RUNS)
+		{
+			mf.close();
+			return RC_INVALID_FILE_FORMAT;
+		}
+		for (int i = 0; i < count; i++)
+		{
+			int id;
+			memcpy(&id, buffer+sizeof(int)*(i+2), sizeof(int));
+			if ((rc = openRun(id)) < 0)
+			{
+				mf.close();
+				close();
+				return rc;
+			}
+		}
+	}
+	mf.close();
+
+	// a new index starts with an empty manifest
+	if (mode == 'w' || mode == 'W')
+		return writeManifest();
+	return 0;
+}
+
+/*
+ * Flush the memtable and close the index.
+ * @return error code. 0 if no error
+ */
+RC LSMTree::close()
+{
+	RC rc = 0;
+	if (!memtable.empty())
+		rc = flush();
+
+	for (unsigned i = 0; i < runFiles.size(); i++)
+	{
+		runFiles[i]->close();
+		delete runFiles[i];
+	}
+	runFiles.clear();
+	runIds.clear();
+	return rc;
+}
+
+/*
+ * Insert (key, RecordId) pair to the index.
+ * @param key[IN] the key for the value inserted into the index
+ * @param rid[IN] the RecordId for the record being inserted into the index
+ * @return error code. 0 if no error
+ */
+RC LSMTree::insert(int key, const RecordId& rid)
+{
+	if (mode != 'w' && mode != 'W')
+		return RC_INVALID_FILE_MODE;
+
+	memtable.insert(make_pair(key, rid));
+	if ((int)memtable.size() >= MEMTABLE_SIZE)
+		return flush();
+	return 0;
+}
+
+/*
+ * Position the cursor at the first entry not smaller than searchKey.
+ * @param searchKey[IN] the key to find
+ * @param cursor[OUT] the merging cursor
+ * @return error code. 0 if no error
+ */
+RC LSMTree::locate(int searchKey, LSMCursor& cursor)
+{
+	RC rc;
+	cursor.runs.resize(runFiles.size());
+	for (unsigned i = 0; i < runFiles.size(); i++)
+	{
+		if ((rc = seekRun(*runFiles[i], searchKey, cursor.runs[i])) < 0)
+			return rc;
+	}
+	cursor.mem = memtable.lower_bound(searchKey);
+	return 0;
+}
+
+/*
+ * Read the smallest (key, rid) pair under the cursor,
+ * and move forward the cursor to the next entry.
+ * @param cursor[IN/OUT] the merging cursor
+ * @param key[OUT] the key of the entry
+ * @param rid[OUT] the RecordId of the entry
+ * @return error code. RC_END_OF_TREE if there are no more entries
+ */
+RC LSMTree::readForward(LSMCursor& cursor, int& key, RecordId& rid)
+{
+	RC rc;
+
+	// pick the source with the smallest head key. on ties, older runs
+	// come first and the memtable last, so duplicates stay in insert order.
+	int best = -1;
+	int bestKey = 0;
+	RecordId bestRid;
+	for (unsigned i = 0; i < cursor.runs.size(); i++)
+	{
+		RunCursor& run = cursor.runs[i];
+		if (run.pid == -1)
+			continue;
+		int k;
+		RecordId r;
+		readRunEntry(run.page, run.eid, k, r);
+		if (best == -1 || k < bestKey)
+		{
+			best = i;
+			bestKey = k;
+			bestRid = r;
+		}
+	}
+	bool fromMem = (cursor.mem != memtable.end() &&
+	                (best == -1 || cursor.mem->first < bestKey));
+
+	if (fromMem)
+	{
+		key = cursor.mem->first;
+		rid = cursor.mem->second;
+		++cursor.mem;
+		return 0;
+	}
+	if (best == -1)
+		return RC_END_OF_TREE;
+
+	key = bestKey;
+	rid = bestRid;
+
+	// move the run forward, reading its next page if needed
+	RunCursor& run = cursor.runs[best];
+	if (++run.eid >= run.count)
+	{
+		run.eid = 0;
+		if (++run.pid >= runFiles[best]->endPid())
+			run.pid = -1;
+		else
+		{
+			if ((rc = runFiles[best]->read(run.pid, run.page)) < 0)
+				return rc;
+			memcpy(&run.count, run.page, sizeof(int));
+		}
+	}
+	return 0;
+}
+
+/*
+ * Write the memtable to a new sorted run, and compact the runs
+ * if there are too many of them.
+ */
+RC LSMTree::flush()
+{
+	RC rc;
+	if (memtable.empty())
+		return 0;
+
+	LSMCursor cursor;
+	cursor.mem = memtable.begin();
+	int id = nextRunId++;
+	if ((rc = writeRun(id, cursor)) < 0)
+		return rc;
+	memtable.clear();
+	if ((rc = openRun(id)) < 0)
+		return rc;
+
+	// size-tiered compaction: whenever the newest MAX_RUN_COUNT runs are
+	// in the same tier, merge them into one run of the next tier
+	for (;;)
+	{
+		int count = runIds.size();
+		if (count >= MAX_MANIFEST_RUNS)
+			return compact(0);
+		if (count < MAX_RUN_COUNT)
+			break;
+		int tier = runTier(count-1);
+		int first = count - MAX_RUN_COUNT;
+		for (int i = count-2; i >= first; i--)
+		{
+			if (runTier(i) != tier)
+				return writeManifest();
+		}
+		if ((rc = compact(first)) < 0)
+			return rc;
+	}
+	return writeManifest();
+}
+
+/*
+ * Return the tier of the i'th run. A run written from a single memtable
+ * is in tier 0, and each tier holds MAX_RUN_COUNT times more pages.
+ */
+int LSMTree::runTier(int i) const
+{
+	int pages = runFiles[i]->endPid();
+	int limit = (MEMTABLE_SIZE + RUN_ENTRIES_PER_PAGE - 1) / RUN_ENTRIES_PER_PAGE;
+	int tier = 0;
+	while (pages > limit)
+	{
+		limit *= MAX_RUN_COUNT;
+		tier++;
+	}
+	return tier;
+}
+
+/*
+ * Merge the runs from the first'th to the newest into a single new run,
+ * and remove the old run files.
+ * Compaction is done in the foreground right after a flush because the
+ * page cache of PageFile is shared by the whole process and is not
+ * safe to use from a second thread.
+ */
+RC LSMTree::compact(int first)
+{
+	RC rc;
+
+	// the memtable is empty right after a flush. skip the runs in front
+	// of first, so that the cursor merges runs [first, newest] only
+	LSMCursor cursor;
+	if ((rc = locate(INT_MIN, cursor)) < 0)
+		return rc;
+	for (int i = 0; i < first; i++)
+		cursor.runs[i].pid = -1;
+	int id = nextRunId++;
+	if ((rc = writeRun(id, cursor)) < 0)
+		return rc;
+
+	vector<int> oldIds(runIds.begin()+first, runIds.end());
+	for (unsigned i = first; i < runFiles.size(); i++)
+	{
+		runFiles[i]->close();
+		delete runFiles[i];
+	}
+	runFiles.resize(first);
+	runIds.resize(first);
+	if ((rc = openRun(id)) < 0)
+		return rc;
+
+	// switch to the new run before the old ones are removed
+	if ((rc = writeManifest()) < 0)
+		return rc;
+	for (unsigned i = 0; i < oldIds.size(); i++)
+		::unlink(runName(oldIds[i]).c_str());
+	return 0;
+}
+
+/*
+ * Write the list of runs to the manifest file.
+ */
+RC LSMTree::writeManifest()
+{
+	RC rc;
+	PageFile mf;
+	char buffer[PageFile::PAGE_SIZE];
+
+	memset(buffer, 0, sizeof(buffer));
+	int count = runIds.size();
+	memcpy(buffer, &count, sizeof(int));
+	memcpy(buffer+sizeof(int), &nextRunId, sizeof(int));
+	for (int i = 0; i < count; i++)
+		memcpy(buffer+sizeof(int)*(i+2), &runIds[i], sizeof(int));
+
+	if ((rc = mf.open(name, 'w')) < 0)
+		return rc;
+	rc = mf.write(0, buffer);
+	mf.close();
+	return rc;
+}
+
+/*
+ * Open the run with the given id and add it as the newest run.
+ */
+RC LSMTree::openRun(int id)
+{
+	RC rc;
+	PageFile* pf = new PageFile();
+	if ((rc = pf->open(runName(id), 'r')) < 0)
+	{
+		delete pf;
+		return rc;
+	}
+	runIds.push_back(id);
+	runFiles.push_back(pf);
+	return 0;
+}
+
+/*
+ * Return the name of the file that stores the run with the given id.
+ */
+string LSMTree::runName(int id) const
+{
+	char suffix[16];
+	sprintf(suffix, ".%d", id);
+	return name + suffix;
+}
+
+/*
+ * Position the run cursor at the first entry of the run whose key is
+ * not smaller than searchKey, using a binary search over the pages.
+ */
+RC LSMTree::seekRun(const PageFile& pf, int searchKey, RunCursor& run) const
+{
+	RC rc;
+	int key;
+	RecordId rid;
+
+	// find the first page whose last key is not smaller than searchKey
+	PageId low = 0, high = pf.endPid();
+	while (low < high)
+	{
+		PageId mid = low + (high - low) / 2;
+		if ((rc = pf.read(mid, run.page)) < 0)
+			return rc;
+		memcpy(&run.count, run.page, sizeof(int));
+		readRunEntry(run.page, run.count-1, key, rid);
+		if (key < searchKey)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	if (low == pf.endPid())
+	{
+		run.pid = -1;
+		return 0;
+	}
+
+	if ((rc = pf.read(low, run.page)) < 0)
+		return rc;
+	memcpy(&run.count, run.page, sizeof(int));
+	run.pid = low;
+	for (run.eid = 0; run.eid < run.count; run.eid++)
+	{
+		readRunEntry(run.page, run.eid, key, rid);
+		if (key >= searchKey)
+			break;
+	}
+	return 0;
+}
+
+/*
+ * Drain the cursor into a new run file with the given id.
+ */
+RC LSMTree::writeRun(int id, LSMCursor& cursor)
+{
+	RC rc;
+	PageFile pf;
+	char page[PageFile::PAGE_SIZE];
+	PageId pid = 0;
+	int count = 0;
+	int key;
+	RecordId rid;
+
+	if ((rc = pf.open(runName(id), 'w')) < 0)
+		return rc;
+
+	memset(page, 0, sizeof(page));
+	while (readForward(cursor, key, rid) == 0)
+	{
+		writeRunEntry(page, count++, key, rid);
+		if (count == RUN_ENTRIES_PER_PAGE)
+		{
+			memcpy(page, &count, sizeof(int));
+			if ((rc = pf.write(pid++, page)) < 0)
+				break;
+			memset(page, 0, sizeof(page));
+			count = 0;
+		}
+	}
+	if (rc == 0 && count > 0)
+	{
+		memcpy(page, &count, sizeof(int));
+		rc = pf.write(pid, page);
+	}
+	pf.close();
+	return rc;
+}
@@ -0,0 +1,129 @@
+#ifndef LSMTREE_H
+#define LSMTREE_H
+
+#include "Bruinbase.h"
+#include "PageFile.h"
+#include "RecordFile.h"
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * The position of a merging scan inside one sorted run of an LSMTree.
+ * The page under the cursor is kept in the cursor itself, so that
+ * the run file is read only when the cursor moves to a new page.
+ */
+typedef struct {
+  // PageId of the current page. -1 if the run is exhausted
+  PageId  pid;
+  // The entry number inside the page
+  int     eid;
+  // # entries in the current page
+  int     count;
+  // The content of the current page
+  char    page[PageFile::PAGE_SIZE];
+} RunCursor;
+
+/**
+ * The data structure to point to the next entry of a merging scan
+ * over all sorted runs and the memtable of an LSMTree.
+ */
+typedef struct {
+  // the position in each sorted run
+  std::vector<RunCursor> runs;
+  // the position in the memtable
+  std::multimap<int, RecordId>::const_iterator mem;
+} LSMCursor;
+
+/**
+ * Implements a log-structured merge tree index for bruinbase.
+ * New (key, RecordId) pairs go to an in-memory sorted memtable. When the
+ * memtable grows beyond MEMTABLE_SIZE entries, it is written out as an
+ * immutable sorted run file. When MAX_RUN_COUNT runs of similar size pile
+ * up, they are merged into a single run (size-tiered compaction).
+ * A scan merges all runs and the memtable.
+ *
+ * The list of runs is kept in the manifest file (the index name), and
+ * the run with id n is stored in the file "<index name>.<n>".
+ */
+class LSMTree {
+ public:
+  // # entries in the memtable before it is flushed to a sorted run
+  static const int MEMTABLE_SIZE = 8192;
+
+  // # sorted runs that triggers a compaction
+  static const int MAX_RUN_COUNT = 4;
+
+  LSMTree();
+
+  /**
+   * Open the index in read or write mode.
+   * Under 'w' mode, the index should be created if it does not exist.
+   * @param indexname[IN] the name of the manifest file of the index
+   * @param mode[IN] 'r' for read, 'w' for write
+   * @return error code. 0 if no error
+   */
+  RC open(const std::string& indexname, char mode);
+
+  /**
+   * Flush the memtable and close the index.
+   * @return error code. 0 if no error
+   */
+  RC close();
+
+  /**
+   * Insert (key, RecordId) pair to the index.
+   * @param key[IN] the key for the value inserted into the index
+   * @param rid[IN] the RecordId for the record being inserted into the index
+   * @return error code. 0 if no error
+   */
+  RC insert(int key, const RecordId& rid);
+
+  /**
+   * Position the cursor at the first index entry whose key is
+   * not smaller than searchKey in every run and in the memtable.
+   * Use readForward() to retrieve the entries in key order.
+   * @param searchKey[IN] the key to find
+   * @param cursor[OUT] the merging cursor
+   * @return error code. 0 if no error
+   */
+  RC locate(int searchKey, LSMCursor& cursor);
+
+  /**
+   * Read the smallest (key, rid) pair under the cursor,
+   * and move forward the cursor to the next entry.
+   * @param cursor[IN/OUT] the merging cursor
+   * @param key[OUT] the key of the entry
+   * @param rid[OUT] the RecordId of the entry
+   * @return error code. RC_END_OF_TREE if there are no more entries
+   */
+  RC readForward(LSMCursor& cursor, int& key, RecordId& rid);
+
+ private:
+  // # (key, RecordId) entries in a page of a run.
+  // the first four bytes of a page store # entries in the page.
+  static const int RUN_ENTRIES_PER_PAGE = (PageFile::PAGE_SIZE - sizeof(int)) / (sizeof(int) + sizeof(RecordId));
+
+  // the largest # runs that can be listed in the manifest page
+  static const int MAX_MANIFEST_RUNS = PageFile::PAGE_SIZE / sizeof(int) - 2;
+
+  std::string name;  /// the name of the manifest file
+  char        mode;  /// the mode the index was opened in
+
+  std::vector<int>       runIds;   /// the ids of the runs, oldest first
+  std::vector<PageFile*> runFiles; /// the open run files, in the same order
+  int                    nextRunId;
+
+  std::multimap<int, RecordId> memtable;
+
+  RC flush();
+  RC compact(int first);
+  int runTier(int i) const;
+  RC writeManifest();
+  RC openRun(int id);
+  std::string runName(int id) const;
+  RC seekRun(const PageFile& pf, int searchKey, RunCursor& rc) const;
+  RC writeRun(int id, LSMCursor& cursor);
+};
+
+#endif /* LSMTREE_H */
@@ -0,0 +1,275 @@
+#include "Predicate.h"
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+#include <functional>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// key <op> constant, with the comparator fixed at compile time
+template <class Compare>
+class KeyComparison : public KeyCondition {
+ public:
+  KeyComparison(int c) : constant(c) {}
+  bool match(int key) const { return Compare()(key, constant); }
+ private:
+  int constant;
+};
+
+// value <op> constant, with the comparator fixed at compile time.
+// values are compared with strcmp() like the rest of Bruinbase
+template <class Compare>
+class ValueComparison : public ValueCondition {
+ public:
+  ValueComparison(const string& c) : constant(c) {}
+  bool match(const string& value) const
+  {
+    return Compare()(strcmp(value.c_str(), constant.c_str()), 0);
+  }
+ private:
+  string constant;
+};
+
+// value IN (...), with the list sorted for binary search
+class ValueIn : public ValueCondition {
+ public:
+  ValueIn(const vector<string>& list) : values(list) {}
+  bool match(const string& value) const
+  {
+    return binary_search(values.begin(), values.end(), value);
+  }
+ private:
+  vector<string> values;
+};
+
+// the sorted list of an IN condition, without duplicates
+template <class T>
+static void sortList(vector<T>& list)
+{
+  sort(list.begin(), list.end());
+  list.erase(unique(list.begin(), list.end()), list.end());
+}
+
+// keep the items of list that are also in other. both lists are sorted
+template <class T>
+static void intersectList(vector<T>& list, const vector<T>& other)
+{
+  vector<T> common;
+  set_intersection(list.begin(), list.end(), other.begin(), other.end(),
+                   back_inserter(common));
+  list.swap(common);
+}
+
+Predicate::Predicate()
+{
+  lower = INT_MIN;
+  upper = INT_MAX;
+  keyRange = keyList = false;
+}
+
+Predicate::~Predicate()
+{
+  clear();
+}
+
+void Predicate::clear()
+{
+  for (unsigned i = 0; i < keyConds.size(); i++) delete keyConds[i];
+  for (unsigned i = 0; i < valueConds.size(); i++) delete valueConds[i];
+  keyConds.clear();
+  valueConds.clear();
+  keys.clear();
+  lower = INT_MIN;
+  upper = INT_MAX;
+  keyRange = keyList = false;
+}
+
+// no key is in [INT_MAX, INT_MIN], and the later conditions do not widen it
+void Predicate::setFalse()
+{
+  lower = INT_MAX;
+  upper = INT_MIN;
+}
+
+void Predicate::compile(const vector<SelCond>& conds)
+{
+  vector<int> excluded;           // the keys of "key <> c"
+  bool hasValueEq = false;        // "value = c"
+  string valueEq;
+  bool hasValueList = false;      // "value IN (...)"
+  vector<string> valueList;
+  vector<ValueCondition*> others; // the other conditions on value
+  vector<string> list;
+  vector<int> keyIn;
+  int c;
+
+  clear();
+
+  for (unsigned i = 0; i < conds.size(); i++) {
+    const SelCond& cond = conds[i];
+
+    if (cond.attr == 1) {
+      if (cond.comp == SelCond::IN) {
+        keyIn.clear();
+        for (unsigned j = 0; j < cond.values.size(); j++) {
+          keyIn.push_back(atoi(cond.values[j]));
+        }
+        sortList(keyIn);
+        if (keyList) intersectList(keys, keyIn);
+        else keys.swap(keyIn);
+        keyList = true;
+        continue;
+      }
+
+      c = atoi(cond.value);
+      switch (cond.comp) {
+      case SelCond::EQ:
+        lower = max(lower, c);
+        upper = min(upper, c);
+        break;
+      case SelCond::GT:
+        if (c == INT_MAX) setFalse();
+        else lower = max(lower, c + 1);
+        break;
+      case SelCond::LT:
+        if (c == INT_MIN) setFalse();
+        else upper = min(upper, c - 1);
+        break;
+      case SelCond::GE:
+        lower = max(lower, c);
+        break;
+      case SelCond::LE:
+        upper = min(upper, c);
+        break;
+      case SelCond::NE:
+        excluded.push_back(c);
+        break;
+      default:
+        break;
+      }
+      if (cond.comp != SelCond::NE) keyRange = true;
+    } else {
+      switch (cond.comp) {
+      case SelCond::EQ:
+        // two different equality constants never match
+        if (hasValueEq && valueEq != cond.value) setFalse();
+        hasValueEq = true;
+        valueEq = cond.value;
+        break;
+      case SelCond::IN:
+        list.assign(cond.values.begin(), cond.values.end());
+        sortList(list);
+        if (hasValueList) intersectList(valueList, list);
+        else valueList.swap(list);
+        hasValueList = true;
+        break;
+      case SelCond::NE:
+        others.push_back(new ValueComparison<not_equal_to<int> >(cond.value));
+        break;
+      case SelCond::LT:
+        others.insert(others.begin(), new ValueComparison<less<int> >(cond.value));
+        break;
+      case SelCond::GT:
+        others.insert(others.begin(), new ValueComparison<greater<int> >(cond.value));
+        break;
+      case SelCond::LE:
+        others.insert(others.begin(), new ValueComparison<less_equal<int> >(cond.value));
+        break;
+      case SelCond::GE:
+        others.insert(others.begin(), new ValueComparison<greater_equal<int> >(cond.value));
+        break;
+      }
+    }
+  }
+
+  // the key list and the key range narrow each other
+  sortList(excluded);
+  if (keyList) {
+    vector<int> matching;
+    for (unsigned i = 0; i < keys.size(); i++) {
+      if (keys[i] >= lower && keys[i] <= upper &&
+          !binary_search(excluded.begin(), excluded.end(), keys[i])) {
+        matching.push_back(keys[i]);
+      }
+    }
+    keys.swap(matching);
+    excluded.clear();
+    if (keys.empty()) {
+      setFalse();
+    } else {
+      lower = keys.front();
+      upper = keys.back();
+    }
+  }
+
+  // a "<>" at an end of the key range moves the end. the others are
+  // checked on each key
+  for (unsigned i = 0; i < excluded.size() && lower <= upper; i++) {
+    if (excluded[i] != lower) continue;
+    if (lower == INT_MAX) setFalse();
+    else lower++;
+  }
+  for (int i = excluded.size() - 1; i >= 0 && lower <= upper; i--) {
+    if (excluded[i] != upper) continue;
+    if (upper == INT_MIN) setFalse();
+    else upper--;
+  }
+  for (unsigned i = 0; i < excluded.size(); i++) {
+    if (excluded[i] > lower && excluded[i] < upper) {
+      keyConds.push_back(new KeyComparison<not_equal_to<int> >(excluded[i]));
+    }
+  }
+
+  // value equality is the most selective check, then the IN list
+  if (hasValueEq) {
+    if (hasValueList && !binary_search(valueList.begin(), valueList.end(), valueEq)) {
+      setFalse();
+    }
+    valueConds.push_back(new ValueComparison<equal_to<int> >(valueEq));
+  } else if (hasValueList) {
+    if (valueList.empty()) setFalse();
+    valueConds.push_back(new ValueIn(valueList));
+  }
+  valueConds.insert(valueConds.end(), others.begin(), others.end());
+}
+
+int Predicate::filterKeys(const int* keys, int n, int* sel) const
+{
+  int count = 0;
+  int i = 0;
+
+#ifdef __SSE2__
+  // compare four keys at a time with both ends of the key range
+  __m128i lo = _mm_set1_epi32(lower);
+  __m128i hi = _mm_set1_epi32(upper);
+  for (; i + 4 <= n; i += 4) {
+    __m128i k = _mm_loadu_si128((const __m128i*)(keys + i));
+    __m128i out = _mm_or_si128(_mm_cmplt_epi32(k, lo), _mm_cmpgt_epi32(k, hi));
+    int mask = ~_mm_movemask_ps(_mm_castsi128_ps(out));
+    for (int j = 0; j < 4; j++) {
+      sel[count] = i + j;
+      count += (mask >> j) & 1;
+    }
+  }
+#endif
+
+  // the remaining keys, without branches
+  for (; i < n; i++) {
+    sel[count] = i;
+    count += (keys[i] >= lower) & (keys[i] <= upper);
+  }
+
+  // the key list and the "<>" conditions are checked on the keys in range
+  if (keyList || !keyConds.empty()) {
+    int m = 0;
+    for (int j = 0; j < count; j++) {
+      if (matchKey(keys[sel[j]])) sel[m++] = sel[j];
+    }
+    count = m;
+  }
+
+  return count;
+}
@@ -0,0 +1,137 @@
+#ifndef PREDICATE_H
+#define PREDICATE_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "SqlEngine.h"
+
+/**
+ * a condition on key that is not folded into the key range of a Predicate
+ */
+class KeyCondition {
+ public:
+  virtual ~KeyCondition() {}
+  virtual bool match(int key) const = 0;
+};
+
+/**
+ * a condition on value
+ */
+class ValueCondition {
+ public:
+  virtual ~ValueCondition() {}
+  virtual bool match(const std::string& value) const = 0;
+};
+
+/**
+ * The conditions of a WHERE clause, compiled once per query.
+ * The constants are parsed by compile(), and the conditions on key are
+ * folded into a key range [lower, upper] and an optional sorted list of
+ * keys (the IN lists). The remaining conditions are checked in order of
+ * cost: the conditions on key first, then the value equality and IN
+ * conditions, then the other conditions on value. A contradiction, such
+ * as "key = 5 AND key = 6", is found by compile() and makes isFalse() true.
+ */
+class Predicate {
+ public:
+  Predicate();
+  ~Predicate();
+
+  /**
+   * compile the conditions of a WHERE clause, ANDed together.
+   * @param conds[IN] the conditions to compile
+   */
+  void compile(const std::vector<SelCond>& conds);
+
+  /**
+   * @return true if no tuple can match the conditions
+   */
+  bool isFalse() const { return lower > upper; }
+
+  /**
+   * @return the smallest key a matching tuple may have
+   */
+  int getLower() const { return lower; }
+
+  /**
+   * @return the largest key a matching tuple may have
+   */
+  int getUpper() const { return upper; }
+
+  /**
+   * @return true if a comparison (=, <, >, <= or >=) on key narrows the key range
+   */
+  bool hasKeyRange() const { return keyRange; }
+
+  /**
+   * @return true if the matching keys are listed by an IN condition on key
+   */
+  bool hasKeyList() const { return keyList; }
+
+  /**
+   * @return the sorted keys a matching tuple may have, if hasKeyList()
+   */
+  const std::vector<int>& getKeys() const { return keys; }
+
+  /**
+   * @return true if the value must be read to check the conditions
+   */
+  bool needsValue() const { return !valueConds.empty(); }
+
+  /**
+   * check the conditions on key.
+   * @param key[IN] the key of the tuple
+   * @return true if the key meets all conditions on key
+   */
+  bool matchKey(int key) const
+  {
+    if (key < lower || key > upper) return false;
+    if (keyList && !std::binary_search(keys.begin(), keys.end(), key)) return false;
+    for (unsigned i = 0; i < keyConds.size(); i++) {
+      if (!keyConds[i]->match(key)) return false;
+    }
+    return true;
+  }
+
+  /**
+   * check the conditions on key for an array of keys at once.
+   * @param keys[IN] the keys to check
+   * @param n[IN] # keys
+   * @param sel[OUT] the positions in keys of the keys that meet all
+   *                 conditions on key, in order. it needs room for n items
+   * @return # keys that meet all conditions on key
+   */
+  int filterKeys(const int* keys, int n, int* sel) const;
+
+  /**
+   * check the conditions on value.
+   * @param value[IN] the value of the tuple
+   * @return true if the value meets all conditions on value
+   */
+  bool matchValue(const std::string& value) const
+  {
+    for (unsigned i = 0; i < valueConds.size(); i++) {
+      if (!valueConds[i]->match(value)) return false;
+    }
+    return true;
+  }
+
+ private:
+  int  lower;     /// the smallest matching key
+  int  upper;     /// the largest matching key
+  bool keyRange;  /// a comparison on key narrows [lower, upper]
+  bool keyList;   /// an IN condition on key lists the matching keys
+  std::vector<int> keys;  /// the matching keys, sorted, if keyList
+  std::vector<KeyCondition*>   keyConds;    /// the "<>" conditions on key inside [lower, upper]
+  std::vector<ValueCondition*> valueConds;  /// the conditions on value, in the order to check
+
+  void clear();
+  void setFalse();
+
+  // a Predicate owns its conditions, and is not copied
+  Predicate(const Predicate&);
+  Predicate& operator=(const Predicate&);
+};
+
+#endif /* PREDICATE_H */
@@ -0,0 +1,152 @@
+#include "ResultSink.h"
+
+// the two-digit numbers 00 to 99, for putInt()
+static const char DIGIT_PAIRS[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+ResultSink::ResultSink(FILE* out, bool binary, int attr)
+{
+  this->out = out;
+  this->binary = binary;
+  this->attr = attr;
+  used = 0;
+  offsets.push_back(0);
+  aggCount = aggMin = aggMax = 0;
+  aggSum = 0;
+}
+
+ResultSink::~ResultSink()
+{
+  flush();
+}
+
+void ResultSink::putInt(int n)
+{
+  char digits[11];  // the digits of the largest unsigned int
+  int  pos = sizeof(digits);
+
+  // negate as unsigned, so that INT_MIN does not overflow
+  unsigned u = (n < 0) ? 0u - (unsigned) n : (unsigned) n;
+
+  // fill the digits from the right, two at a time
+  while (u >= 100) {
+    unsigned pair = (u % 100) * 2;
+    u /= 100;
+    digits[--pos] = DIGIT_PAIRS[pair + 1];
+    digits[--pos] = DIGIT_PAIRS[pair];
+  }
+  if (u >= 10) {
+    digits[--pos] = DIGIT_PAIRS[u * 2 + 1];
+    digits[--pos] = DIGIT_PAIRS[u * 2];
+  } else {
+    digits[--pos] = '0' + u;
+  }
+
+  if (n < 0) putChar('-');
+  putString(digits + pos, sizeof(digits) - pos);
+}
+
+void ResultSink::putString(const char* s, int len)
+{
+  if (len > BUFFER_SIZE - used) {
+    flush();
+    // a string larger than the buffer is written directly
+    if (len > BUFFER_SIZE) {
+      fwrite(s, 1, len, out);
+      return;
+    }
+  }
+  memcpy(buffer + used, s, len);
+  used += len;
+}
+
+RC ResultSink::flush()
+{
+  if (used > 0 && fwrite(buffer, 1, used, out) < (size_t) used) {
+    used = 0;
+    return RC_FILE_WRITE_FAILED;
+  }
+  used = 0;
+  return 0;
+}
+
+void ResultSink::putRow(int key, const std::string& value)
+{
+  keys.push_back(key);
+  values.append(value);
+  offsets.push_back(values.size());
+  if ((int) keys.size() >= BATCH_ROWS) writeBatch();
+}
+
+void ResultSink::writeBatch()
+{
+  int n = keys.size();
+  int padding = (4 - values.size() % 4) % 4;
+  int header[3];
+
+  header[0] = (2 + n + n + 1) * sizeof(int) + values.size() + padding;
+  header[1] = n;
+  header[2] = attr;
+  putString((const char*) header, sizeof(header));
+  if (n > 0) putString((const char*) &keys[0], n * sizeof(int));
+  putString((const char*) &offsets[0], (n + 1) * sizeof(int));
+  putString(values.data(), values.size());
+  putString("\0\0\0", padding);
+
+  keys.clear();
+  offsets.assign(1, 0);
+  values.clear();
+}
+
+void ResultSink::putAggregate()
+{
+  char text[32];
+
+  // MIN, MAX and AVG of no tuples are NULL
+  if (aggCount == 0 && attr != 7) {
+    if (!binary) putString("NULL\n", 5);
+    return;
+  }
+
+  switch (attr) {
+  case 5:  // MIN(key)
+  case 6:  // MAX(key)
+    if (binary) putRow(attr == 5 ? aggMin : aggMax, std::string());
+    else {
+      putInt(attr == 5 ? aggMin : aggMax);
+      putChar('\n');
+    }
+    return;
+  case 7:  // SUM(key)
+    sprintf(text, "%lld", aggSum);
+    break;
+  case 8:  // AVG(key)
+    sprintf(text, "%.3f", (double) aggSum / aggCount);
+    break;
+  default:
+    return;
+  }
+  if (binary) putRow(aggCount, text);
+  else {
+    putString(text, strlen(text));
+    putChar('\n');
+  }
+}
+
+RC ResultSink::finish()
+{
+  if (binary) {
+    if (!keys.empty()) writeBatch();
+    writeBatch();
+  }
+  return flush();
+}
@@ -0,0 +1,149 @@
+#ifndef RESULTSINK_H
+#define RESULTSINK_H
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Bruinbase.h"
+
+/**
+ * Collects the output of a query in a large buffer, and writes it to
+ * a FILE in one fwrite() call when the buffer is full or at flush().
+ * Integers are converted to text by hand, two digits at a time,
+ * instead of by fprintf().
+ *
+ * In binary mode, the tuples given to putRow() are written in batches
+ * of up to BATCH_ROWS tuples, column by column. All fields are 4-byte
+ * integers in host byte order:
+ * ---------------------------------------------------------------------------------
+ * |--batch size in bytes, not counting this field--|--# tuples n--|--SELECT attr--|
+ * |--n keys--|--n+1 offsets of the values in the value bytes--|--value bytes--|
+ * ---------------------------------------------------------------------------------
+ * The value bytes are padded to a multiple of 4 bytes. A batch with no
+ * tuples ends the result of a query. A tuple of "SELECT key" has the
+ * key and an empty value, and one of "SELECT value" or "SELECT *" the
+ * key and the value. The result of "SELECT COUNT(*)" is a single tuple
+ * with the count as its key and an empty value. The result of
+ * "SELECT MIN(key)" or "MAX(key)" is a single tuple with the key, and
+ * that of "SUM(key)" or "AVG(key)" a single tuple with the # tuples as
+ * its key and the result in decimal as its value. MIN, MAX and AVG of
+ * no tuples have no result tuple (NULL in text output). A group of
+ * "SELECT value, COUNT(*) ... GROUP BY value" is a tuple with the count
+ * as its key. A tuple of "SELECT *" on a join has the values of both
+ * tables as its value, separated by a '\0'.
+ */
+class ResultSink {
+ public:
+  // the size of the output buffer
+  static const int BUFFER_SIZE = 65536;
+
+  // # tuples in a batch of binary output, at most
+  static const int BATCH_ROWS = 4096;
+
+  /**
+   * @param out[IN] the FILE the output goes to
+   * @param binary[IN] write the tuples in binary batches
+   * @param attr[IN] the attribute of the SELECT clause, written in
+   *                 the batches of binary output
+   */
+  ResultSink(FILE* out, bool binary = false, int attr = 0);
+
+  /**
+   * @return true if the tuples are written in binary batches
+   */
+  bool isBinary() const { return binary; }
+
+  /**
+   * add a tuple to the current batch of binary output.
+   * @param key[IN] the key of the tuple
+   * @param value[IN] the value of the tuple
+   */
+  void putRow(int key, const std::string& value);
+
+  /**
+   * fold the key of a matching tuple into the result of
+   * "SELECT MIN(key)", "MAX(key)", "SUM(key)" or "AVG(key)".
+   * @param key[IN] the key of the tuple
+   */
+  void addKey(int key)
+  {
+    if (aggCount == 0 || key < aggMin) aggMin = key;
+    if (aggCount == 0 || key > aggMax) aggMax = key;
+    aggSum += key;
+    aggCount++;
+  }
+
+  /**
+   * append the result of the keys given to addKey(), for the
+   * aggregate of the SELECT clause.
+   */
+  void putAggregate();
+
+  /**
+   * end the result of a query: the last batch and an empty batch are
+   * written in binary mode, and the output is flushed.
+   * @return error code. 0 if no error
+   */
+  RC finish();
+
+  /**
+   * the remaining output is flushed
+   */
+  ~ResultSink();
+
+  /**
+   * append an integer in decimal.
+   * @param n[IN] the integer
+   */
+  void putInt(int n);
+
+  /**
+   * append a string.
+   * @param s[IN] the string
+   * @param len[IN] the length of the string
+   */
+  void putString(const char* s, int len);
+
+  void putString(const std::string& s) { putString(s.data(), s.size()); }
+
+  /**
+   * append a character.
+   * @param c[IN] the character
+   */
+  void putChar(char c)
+  {
+    if (used == BUFFER_SIZE) flush();
+    buffer[used++] = c;
+  }
+
+  /**
+   * write the buffered output to the FILE.
+   * @return error code. 0 if no error
+   */
+  RC flush();
+
+ private:
+  FILE* out;     /// the FILE the output goes to
+  int   used;    /// # bytes in buffer
+  char  buffer[BUFFER_SIZE];
+
+  bool  binary;  /// write the tuples in binary batches
+  int   attr;    /// the attribute of the SELECT clause
+  std::vector<int> keys;     /// the keys of the current batch
+  std::vector<int> offsets;  /// the value offsets of the current batch
+  std::string      values;   /// the value bytes of the current batch
+
+  int       aggCount;  /// # keys given to addKey()
+  int       aggMin;    /// the smallest of them
+  int       aggMax;    /// the largest of them
+  long long aggSum;    /// their sum
+
+  void writeBatch();
+
+  // a ResultSink owns its buffer, and is not copied
+  ResultSink(const ResultSink&);
+  ResultSink& operator=(const ResultSink&);
+};
+
+#endif /* RESULTSINK_H */
@@ -0,0 +1,147 @@
+#include "RowSorter.h"
+#include <cstdio>
+#include <unistd.h>
+#include <algorithm>
+
+using namespace std;
+
+// the order of the heads of the runs in the merge heap: the heap keeps
+// the tuple that comes first on top. on equal tuples, the earlier run
+// comes first
+struct HeadOrder {
+  RowOrder before;
+
+  HeadOrder(const RowOrder& order) : before(order) {}
+  bool operator()(const pair<pair<int, string>, int>& a,
+                  const pair<pair<int, string>, int>& b) const
+  {
+    if (before(b.first, a.first)) return true;
+    return !before(a.first, b.first) && a.second > b.second;
+  }
+};
+
+RowSorter::RowSorter(const RowOrder& order, int limit, const string& name)
+{
+  this->before = order;
+  this->limit = limit;
+  this->name = name;
+  topK = (limit >= 0 && limit <= RUN_SIZE);
+  next = 0;
+}
+
+RowSorter::~RowSorter()
+{
+  char suffix[16];
+
+  for (unsigned i = 0; i < runs.size(); i++) {
+    sprintf(suffix, ".%d", i);
+    runs[i]->close();
+    ::unlink((name + suffix).c_str());
+    delete runs[i];
+  }
+}
+
+RC RowSorter::add(int key, const string& value)
+{
+  pair<int, string> row(key, value);
+
+  if (!topK) {
+    rows.push_back(row);
+    return (rows.size() >= (unsigned) RUN_SIZE) ? writeRun() : 0;
+  }
+
+  // the heap keeps the last of the first limit tuples on top, and a
+  // tuple that comes before it takes its place
+  if ((int) rows.size() < limit) {
+    rows.push_back(row);
+    push_heap(rows.begin(), rows.end(), before);
+  } else if (limit > 0 && before(row, rows.front())) {
+    pop_heap(rows.begin(), rows.end(), before);
+    rows.back() = row;
+    push_heap(rows.begin(), rows.end(), before);
+  }
+  return 0;
+}
+
+// sort the tuples in memory and write them to the next run
+RC RowSorter::writeRun()
+{
+  RC       rc;
+  RecordId rid;
+  char     suffix[16];
+
+  std::sort(rows.begin(), rows.end(), before);
+  sprintf(suffix, ".%d", (int) runs.size());
+  runs.push_back(new RecordFile);
+  ::unlink((name + suffix).c_str());
+  if ((rc = runs.back()->open(name + suffix, 'w')) < 0) return rc;
+  for (unsigned i = 0; i < rows.size(); i++) {
+    if ((rc = runs.back()->append(rows[i].first, rows[i].second, rid)) < 0) return rc;
+  }
+  rows.clear();
+  return runs.back()->close();
+}
+
+// push the next tuple of the i'th run to the merge heap, if any
+RC RowSorter::readRun(int i)
+{
+  RC     rc;
+  int    key;
+  string value;
+
+  if (!(cursors[i] < runs[i]->endRid())) return 0;
+  if ((rc = runs[i]->read(cursors[i], key, value)) < 0) return rc;
+  ++cursors[i];
+  heads.push_back(make_pair(make_pair(key, value), i));
+  push_heap(heads.begin(), heads.end(), HeadOrder(before));
+  return 0;
+}
+
+RC RowSorter::sort()
+{
+  RC   rc;
+  char suffix[16];
+
+  next = 0;
+  if (topK) {
+    sort_heap(rows.begin(), rows.end(), before);
+    return 0;
+  }
+  if (runs.empty()) {
+    std::sort(rows.begin(), rows.end(), before);
+    return 0;
+  }
+
+  // the last run is written too, and the runs are merged
+  if (!rows.empty() && (rc = writeRun()) < 0) return rc;
+  for (unsigned i = 0; i < runs.size(); i++) {
+    sprintf(suffix, ".%d", i);
+    if ((rc = runs[i]->open(name + suffix, 'r')) < 0) return rc;
+    cursors.push_back(RecordId());
+    cursors[i].pid = cursors[i].sid = 0;
+    if ((rc = readRun(i)) < 0) return rc;
+  }
+  return 0;
+}
+
+RC RowSorter::readNext(int& key, string& value)
+{
+  if (limit >= 0 && next >= (unsigned) limit) return RC_END_OF_TREE;
+
+  if (runs.empty()) {
+    if (next >= rows.size()) return RC_END_OF_TREE;
+    key = rows[next].first;
+    value = rows[next].second;
+    next++;
+    return 0;
+  }
+
+  if (heads.empty()) return RC_END_OF_TREE;
+  pop_heap(heads.begin(), heads.end(), HeadOrder(before));
+  key = heads.back().first.first;
+  value.swap(heads.back().first.second);
+  int i = heads.back().second;
+  heads.pop_back();
+  next++;
+  return readRun(i);
+}
@@ -0,0 +1,111 @@
+#ifndef ROWSORTER_H
+#define ROWSORTER_H
+
+#include <string>
+#include <vector>
+#include "Bruinbase.h"
+#include "RecordFile.h"
+
+/**
+ * the order of the tuples of "ORDER BY key" or "ORDER BY value".
+ * tuples equal on the ordered column are ordered by the other one,
+ * so that the order does not depend on how the tuples are found
+ */
+struct RowOrder {
+  bool byValue;     // order by value instead of key
+  bool descending;  // largest first
+
+  /**
+   * @return true if tuple a comes before tuple b
+   */
+  bool operator()(const std::pair<int, std::string>& a,
+                  const std::pair<int, std::string>& b) const
+  {
+    int c;
+    if (byValue) {
+      c = a.second.compare(b.second);
+      if (c == 0) c = (a.first < b.first) ? -1 : (a.first > b.first);
+    } else {
+      c = (a.first < b.first) ? -1 : (a.first > b.first);
+      if (c == 0) c = a.second.compare(b.second);
+    }
+    return descending ? c > 0 : c < 0;
+  }
+};
+
+/**
+ * Sorts the tuples of a query that are not found in the order to print
+ * them, e.g. for "ORDER BY value" or for "ORDER BY key" on a heap scan.
+ * With a LIMIT of at most RUN_SIZE tuples, only the first tuples in the
+ * order are kept, in a heap of LIMIT tuples. Otherwise the tuples are
+ * sorted in runs of RUN_SIZE tuples, and a larger result is written to
+ * temporary RecordFiles and merged while it is read back.
+ * The tuples are given to add(), then sort() is called once, and the
+ * sorted tuples are read with readNext().
+ */
+class RowSorter {
+ public:
+  // # tuples sorted in memory at a time
+  static const int RUN_SIZE = 65536;
+
+  /**
+   * @param order[IN] the order of the tuples
+   * @param limit[IN] # tuples to print at most, or -1 for all
+   * @param name[IN] the prefix of the names of the temporary files
+   */
+  RowSorter(const RowOrder& order, int limit, const std::string& name);
+
+  /**
+   * the temporary files are removed
+   */
+  ~RowSorter();
+
+  /**
+   * add a tuple.
+   * @param key[IN] the key of the tuple
+   * @param value[IN] the value of the tuple
+   * @return error code. 0 if no error
+   */
+  RC add(int key, const std::string& value);
+
+  /**
+   * sort the tuples added so far, to read them with readNext().
+   * @return error code. 0 if no error
+   */
+  RC sort();
+
+  /**
+   * read the next tuple in order.
+   * @param key[OUT] the key of the tuple
+   * @param value[OUT] the value of the tuple
+   * @return error code. RC_END_OF_TREE after the last tuple, or after
+   *         limit tuples
+   */
+  RC readNext(int& key, std::string& value);
+
+  /**
+   * @return true if the tuples did not fit in memory
+   */
+  bool spilled() const { return !runs.empty(); }
+
+ private:
+  RowOrder    before;  /// the order of the tuples
+  int         limit;   /// # tuples to print at most, or -1 for all
+  bool        topK;    /// keep the first limit tuples in a heap
+  std::string name;    /// the runs are name.0, name.1, ...
+  std::vector<std::pair<int, std::string> > rows;  /// the tuples in memory
+  std::vector<RecordFile*> runs;                   /// the sorted runs on disk
+  std::vector<RecordId>    cursors;                /// the next tuple of each run
+  std::vector<std::pair<std::pair<int, std::string>, int> > heads;
+                               /// a heap of the first unread tuple of each run
+  unsigned    next;    /// # tuples read by readNext()
+
+  RC writeRun();
+  RC readRun(int i);
+
+  // a RowSorter owns its temporary files, and is not copied
+  RowSorter(const RowSorter&);
+  RowSorter& operator=(const RowSorter&);
+};
+
+#endif /* ROWSORTER_H */
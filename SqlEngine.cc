@@ -1,347 +1,1850 @@
-/**
- * Copyright (C) 2008 by The Regents of the University of California
- * Redistribution of this file is permitted under the terms of the GNU
- * Public License (GPL).
- *
- * @author Junghoo "John" Cho <cho AT cs.ucla.edu>
- * @date 3/24/2008
- */
-
-#include <cstdio>
-#include <cstring>
-#include <cstdlib>
-#include <iostream>
-#include <fstream>
-#include <climits>
-#include "Bruinbase.h"
-#include "SqlEngine.h"
-#include "BTreeIndex.h"
-
-using namespace std;
-
-// external functions and variables for load file and sql command parsing 
-extern FILE* sqlin;
-int sqlparse(void);
-
-
-RC SqlEngine::run(FILE* commandline)
-{
-  fprintf(stdout, "Bruinbase> ");
-
-  // set the command line input and start parsing user input
-  sqlin = commandline;
-  sqlparse();  // sqlparse() is defined in SqlParser.tab.c generated from
-               // SqlParser.y by bison (bison is GNU equivalent of yacc)
-
-  return 0;
-}
-
-RC SqlEngine::select(int attr, const string& table, const vector<SelCond>& cond)
-{
-  RecordFile rf;   // RecordFile containing the table
-  RecordId   rid;  // record cursor for table scanning
-  BTreeIndex bti;  // BTreeIndex for table
-  bool useBTree = false;
-  int lower = 0, upper = INT_MAX;
-  IndexCursor ic;
-
-  RC     rc;
-  int    key;     
-  string value;
-  int    count;
-  int    diff;
-
-  // open the table file
-  if ((rc = rf.open(table + ".tbl", 'r')) < 0) {
-    fprintf(stderr, "Error: table %s does not exist\n", table.c_str());
-    return rc;
-  }
-
-  // open BTreeIndex file and check condition for BTree search
-  if ((rc = bti.open(table + ".idx", 'r')) == 0) {
-    for (unsigned i = 0; i < cond.size(); i++) {
-      if (cond[i].attr && lower < upper){
-        switch(cond[i].comp){
-          case SelCond::EQ:
-            lower = upper = atoi(cond[i].value);
-            useBTree = (cond[i].attr == 1);
-            break;
-          case SelCond::GT:
-            lower = max(lower, atoi(cond[i].value)+1);
-            useBTree = (cond[i].attr == 1);
-            break;
-          case SelCond::LT:
-            upper = min(upper, atoi(cond[i].value)-1);
-            useBTree = (cond[i].attr == 1);
-            break;
-          case SelCond::GE:
-            lower = max(lower, atoi(cond[i].value));
-            useBTree = (cond[i].attr == 1);
-            break;
-          case SelCond::LE:
-            upper = min(upper, atoi(cond[i].value));
-            useBTree = (cond[i].attr == 1);
-            break;
-        }
-      }
-    }
-
-    if (attr == 4){
-      useBTree = true;
-    }
-  }
-
-  if (useBTree){
-    count = 0;
-    bti.locate(lower, ic);
-    rc = bti.readForward(ic, key, rid);
-    while (key<=upper && rc==0){
-
-      // check the conditions on the tuple
-      for (unsigned i = 0; i < cond.size(); i++) {
-        // compute the difference between the tuple value and the condition value
-        switch (cond[i].attr) {
-        case 1:
-         diff = key - atoi(cond[i].value);
-         break;
-        case 2:
-        // read value
-        if ((rc = rf.read(rid, key, value)) < 0) {
-          fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
-          goto exit_select;
-        }
-         diff = strcmp(value.c_str(), cond[i].value);
-         break;
-        }
-
-        // skip the tuple if any condition is not met
-        switch (cond[i].comp) {
-        case SelCond::EQ:
-         if (diff != 0) goto next_tuple_BTree;
-         break;
-        case SelCond::NE:
-         if (diff == 0) goto next_tuple_BTree;
-         break;
-        case SelCond::GT:
-         if (diff <= 0) goto next_tuple_BTree;
-         break;
-        case SelCond::LT:
-         if (diff >= 0) goto next_tuple_BTree;
-         break;
-        case SelCond::GE:
-         if (diff < 0) goto next_tuple_BTree;
-         break;
-        case SelCond::LE:
-         if (diff > 0) goto next_tuple_BTree;
-         break;
-        }
-      }
-
-      // the condition is met for the tuple. 
-      // increase matching tuple counter
-      count++;
-
-      // print the tuple 
-      switch (attr) {
-      case 1:  // SELECT key
-        fprintf(stdout, "%d\n", key);
-        break;
-      case 2:  // SELECT value
-        if ((rc = rf.read(rid, key, value)) < 0) {
-          fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
-          goto exit_select;
-        }
-        fprintf(stdout, "%s\n", value.c_str());
-        break;
-      case 3:  // SELECT *
-        if ((rc = rf.read(rid, key, value)) < 0) {
-          fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
-          goto exit_select;
-        } 
-        fprintf(stdout, "%d '%s'\n", key, value.c_str());
-        break;
-      }
-
-      // move to the next tuple
-      next_tuple_BTree:
-        rc = bti.readForward(ic, key, rid);
-    }
-
-    // print matching tuple count if "select count(*)"
-    if (attr == 4) {
-      fprintf(stdout, "%d\n", count);
-    }
-    rc = 0;
-  }
-  else {
-
-    // scan the table file from the beginning
-    rid.pid = rid.sid = 0;
-    count = 0;
-    while (rid < rf.endRid()) {
-      // read the tuple
-      if ((rc = rf.read(rid, key, value)) < 0) {
-        fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
-        goto exit_select;
-      }
-
-      // check the conditions on the tuple
-      for (unsigned i = 0; i < cond.size(); i++) {
-        // compute the difference between the tuple value and the condition value
-        switch (cond[i].attr) {
-        case 1:
-  	     diff = key - atoi(cond[i].value);
-  	     break;
-        case 2:
-  	     diff = strcmp(value.c_str(), cond[i].value);
-  	     break;
-        }
-
-        // skip the tuple if any condition is not met
-        switch (cond[i].comp) {
-        case SelCond::EQ:
-  	     if (diff != 0) goto next_tuple;
-  	     break;
-        case SelCond::NE:
-  	     if (diff == 0) goto next_tuple;
-  	     break;
-        case SelCond::GT:
-  	     if (diff <= 0) goto next_tuple;
-  	     break;
-        case SelCond::LT:
-  	     if (diff >= 0) goto next_tuple;
-  	     break;
-        case SelCond::GE:
-  	     if (diff < 0) goto next_tuple;
-  	     break;
-        case SelCond::LE:
-  	     if (diff > 0) goto next_tuple;
-  	     break;
-        }
-      }
-
-      // the condition is met for the tuple. 
-      // increase matching tuple counter
-      count++;
-
-      // print the tuple 
-      switch (attr) {
-      case 1:  // SELECT key
-        fprintf(stdout, "%d\n", key);
-        break;
-      case 2:  // SELECT value
-        fprintf(stdout, "%s\n", value.c_str());
-        break;
-      case 3:  // SELECT *
-        fprintf(stdout, "%d '%s'\n", key, value.c_str());
-        break;
-      }
-
-      // move to the next tuple
-      next_tuple:
-      ++rid;
-    }
-
-    // print matching tuple count if "select count(*)"
-    if (attr == 4) {
-      fprintf(stdout, "%d\n", count);
-    }
-    rc = 0;
-
-    // close the table file and return
-  }
-
-  exit_select:
-  rf.close();
-  return rc;
-
-}
-
-RC SqlEngine::load(const string& table, const string& loadfile, bool index)
-{
-  /* your code here */
-  RecordFile rf;   // RecordFile containing the table
-  RecordId   rid;  // record cursor for table scanning
-
-  BTreeIndex bti;
-
-  RC     rc;
-  int    key;     
-  string value;
-
-  // open the table file
-  if ((rc = rf.open(table + ".tbl", 'w')) < 0) {
-    fprintf(stderr, "Error: table %s cannot be opened\n", table.c_str());
-    return rc;
-  }
-
-  if (index && (rc= bti.open(table+ ".idx", 'w'))<0){
-    fprintf(stderr, "Error: Index BTree cannot be created for table %s\n", table.c_str());
-    return rc;
-  }
-
-  ifstream infile;
-  infile.open(loadfile.c_str());
-  string line;
-
-  while(getline(infile, line)){
-    if (rc=(parseLoadLine(line, key, value))<0){
-      return rc;
-    }
-    // fprintf(stdout, "Load %s\n", value.c_str());
-
-    if ((rc=rf.append(key, value, rid))<0){
-      return rc;
-    }
-    
-    if (index && (rc=bti.insert(key, rid))<0){
-      return rc;
-    }
-  }
-  infile.close();
-  rf.close();
-  if (index)bti.close();
-
-  return 0;
-}
-
-RC SqlEngine::parseLoadLine(const string& line, int& key, string& value)
-{
-    const char *s;
-    char        c;
-    string::size_type loc;
-    
-    // ignore beginning white spaces
-    c = *(s = line.c_str());
-    while (c == ' ' || c == '\t') { c = *++s; }
-
-    // get the integer key value
-    key = atoi(s);
-
-    // look for comma
-    s = strchr(s, ',');
-    if (s == NULL) { return RC_INVALID_FILE_FORMAT; }
-
-    // ignore white spaces
-    do { c = *++s; } while (c == ' ' || c == '\t');
-    
-    // if there is nothing left, set the value to empty string
-    if (c == 0) { 
-        value.erase();
-        return 0;
-    }
-
-    // is the value field delimited by ' or "?
-    if (c == '\'' || c == '"') {
-        s++;
-    } else {
-        c = '\n';
-    }
-
-    // get the value string
-    value.assign(s);
-    loc = value.find(c, 0);
-    if (loc != string::npos) { value.erase(loc); }
-
-    return 0;
-}
+/**
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ *
+ * @author Junghoo "John" Cho <cho AT cs.ucla.edu>
+ * @date 3/24/2008
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <climits>
+#include <algorithm>
+#include <queue>
+#include <map>
+#include <functional>
+#include <unistd.h>
+#include <pthread.h>
+#include "Bruinbase.h"
+#include "SqlEngine.h"
+#include "BTreeIndex.h"
+#include "LSMTree.h"
+#include "HashIndex.h"
+#include "TableStats.h"
+#include "Predicate.h"
+#include "ResultSink.h"
+#include "RowSorter.h"
+#include "HashAggregate.h"
+#include "Catalog.h"
+
+using namespace std;
+
+// external functions and variables for load file and sql command parsing 
+extern FILE* sqlin;
+int sqlparse(void);
+
+// # of (key, RecordId) pairs collected by load() before they are
+// inserted to the index with a single BTreeIndex::insertBatch() call
+static const unsigned LOAD_BATCH_SIZE = 65536;
+
+// # tuples sorted in memory at a time by cluster(). a larger table is
+// sorted in runs of this size, which are merged at the end
+static const unsigned CLUSTER_RUN_SIZE = 65536;
+
+// # threads of a parallel table scan, at most
+static const int MAX_SCAN_THREADS = 32;
+
+// # morsels a table scan may run ahead of the printed tuples, per
+// thread. this bounds the tuples held in memory
+static const int SCAN_WINDOW = 4;
+
+// # index entries collected before their tuples are read from the
+// table in RecordId order by fetchTuples()
+static const unsigned FETCH_BATCH_SIZE = 65536;
+
+// # tuples of the build table of a hash join held in memory at a time.
+// a larger build table is partitioned on disk first
+static const int JOIN_MEMORY_ROWS = 262144;
+
+// # tuples of the outer table looked up in the index of the inner table
+// at a time by an index nested-loop join
+static const unsigned JOIN_BATCH_SIZE = 65536;
+
+// the plan of the last select(), see SqlEngine::getPlan()
+static string plan;
+
+// the groups of the running select() with "GROUP BY value", which
+// printTuple() counts the tuples in
+static HashAggregate* groups = NULL;
+
+// the output of select(), see SqlEngine::setOutput()
+static int   outputFormat = SqlEngine::TEXT_OUTPUT;
+static FILE* outputFile = NULL;  // NULL for stdout
+
+
+RC SqlEngine::run(FILE* commandline)
+{
+  fprintf(stdout, "Bruinbase> ");
+
+  // set the command line input and start parsing user input
+  sqlin = commandline;
+  sqlparse();  // sqlparse() is defined in SqlParser.tab.c generated from
+               // SqlParser.y by bison (bison is GNU equivalent of yacc)
+
+  // close the tables kept open by the queries of the session
+  Catalog::dropAll();
+
+  return 0;
+}
+
+// print a tuple for "SELECT key", "SELECT value" or "SELECT *".
+// the key is folded into the result of "SELECT MIN(key)" and the other
+// aggregates on key, and the tuple is counted in its group for
+// "GROUP BY value". they are printed once at the end
+static void printTuple(ResultSink& out, int attr, int key, const string& value)
+{
+  if (attr == 4) return;  // "SELECT COUNT(*)" prints the count only
+  if (attr == 9) {
+    groups->add(value);  // an error is returned by groups->finish()
+    return;
+  }
+  if (attr > 4) {
+    out.addKey(key);
+    return;
+  }
+  if (out.isBinary()) {
+    // "SELECT key" has no value bytes, whether or not the plan read them
+    out.putRow(key, (attr == 1) ? string() : value);
+    return;
+  }
+
+  switch (attr) {
+  case 1:  // SELECT key
+    out.putInt(key);
+    out.putChar('\n');
+    break;
+  case 2:  // SELECT value
+    out.putString(value);
+    out.putChar('\n');
+    break;
+  case 3:  // SELECT *
+    out.putInt(key);
+    out.putString(" '", 2);
+    out.putString(value);
+    out.putString("'\n", 2);
+    break;
+  }
+}
+
+// print a group of "SELECT value, COUNT(*) ... GROUP BY value"
+static void printGroup(ResultSink& out, const string& value, int count)
+{
+  if (out.isBinary()) {
+    out.putRow(count, value);
+    return;
+  }
+  out.putChar('\'');
+  out.putString(value);
+  out.putString("' ", 2);
+  out.putInt(count);
+  out.putChar('\n');
+}
+
+// print the result of "SELECT COUNT(*)"
+static void printCount(ResultSink& out, int count)
+{
+  if (out.isBinary()) {
+    out.putRow(count, string());
+    return;
+  }
+  out.putInt(count);
+  out.putChar('\n');
+}
+
+// the order of the tuples sorted by RowSorter for ORDER BY
+static RowOrder rowOrder(int order)
+{
+  RowOrder o;
+  o.byValue = (order == SqlEngine::VALUE_ASCENDING || order == SqlEngine::VALUE_DESCENDING);
+  o.descending = (order == SqlEngine::DESCENDING || order == SqlEngine::VALUE_DESCENDING);
+  return o;
+}
+
+// order for the index entries read by fetchTuples()
+static bool lessRid(const pair<int, RecordId>& a, const pair<int, RecordId>& b)
+{
+  return a.second < b.second;
+}
+
+// read the tuples of the index entries from the table in RecordId order,
+// so that each table page is read once, and the pages are read in file
+// order instead of key order. the tuples that meet the conditions on
+// value are counted, and printed to out or appended to rows, whichever
+// is not NULL, unless attr is 4. entries is cleared
+static RC fetchTuples(const RecordFile& rf, const Predicate& pred, int attr, ResultSink* out,
+                      vector<pair<int, string> >* rows, vector<pair<int, RecordId> >& entries,
+                      RecordBlock& block, int& count)
+{
+  RC     rc;
+  PageId pid = -1;
+  string value;
+
+  sort(entries.begin(), entries.end(), lessRid);
+  for (unsigned i = 0; i < entries.size(); i++) {
+    const RecordId& rid = entries[i].second;
+    if (rid.pid != pid) {
+      if ((rc = rf.readBlock(rid.pid, 1, block)) < 0) return rc;
+      pid = rid.pid;
+    }
+    if (rid.sid < 0 || rid.sid >= block.count) return RC_INVALID_RID;
+
+    value.assign(block.values[rid.sid]);
+    if (!pred.matchValue(value)) continue;
+    count++;
+    if (attr == 4) continue;
+    if (out != NULL) printTuple(*out, attr, block.keys[rid.sid], value);
+    else rows->push_back(make_pair(block.keys[rid.sid], value));
+  }
+  entries.clear();
+  return 0;
+}
+
+// the matching tuples of a morsel: a block of RecordBlock::MAX_PAGES
+// pages of a table scan, or a sub-range of an index range scan
+struct Morsel {
+  bool done;  // the morsel has been scanned
+  RC   rc;    // the error while scanning the morsel, if any
+  int  count; // # matching tuples
+  vector<pair<int, string> > rows;  // the matching tuples, unless counted only
+};
+
+// the buffers of a thread of a scan, allocated on first use
+struct ScanBuffers {
+  RecordBlock* block;  // for scanBlock()
+  int*         sel;
+  BTreeIndex*  index;  // for scanRange(). each thread has its own handle of
+                       // the index, which caches the last node it read
+
+  ScanBuffers() : block(NULL), sel(NULL), index(NULL) {}
+  ~ScanBuffers()
+  {
+    delete block;
+    delete [] sel;
+  }
+};
+
+// a scan shared by the threads of runScan()
+struct TableScan {
+  const RecordFile* rf;
+  const Predicate*  pred;
+  const vector<Predicate*>* anyOf;  // for a disjunction, the tuples that meet
+                                    // any of these are matched instead of pred
+  int  attr;
+  bool readsTable;   // the values are needed
+  int  morsels;      // # morsels to scan
+  RC (*scanMorsel)(const TableScan& scan, int m, ScanBuffers& buffers, Morsel& out);
+
+  // for an index range scan, the m'th morsel is the key range
+  // [splits[m-1], splits[m] - 1], where splits[-1] is lower and
+  // splits[morsels-1] is upper + 1. with fetchByRid, the tuples of a
+  // morsel are read from the table in RecordId order
+  vector<BTreeIndex*> indexes;  // a handle of the index for each thread,
+                                // owned by the Catalog
+  bool fetchByRid;
+  int  lower;
+  int  upper;
+  vector<int> splits;
+
+  int  limit;        // # tuples to print at most, or -1 for all
+  int  window;       // # morsels a thread may run ahead of the merge
+  pthread_mutex_t lock;     // protects the members below
+  pthread_cond_t  changed;  // signaled when a morsel is scanned or merged
+  int  started;      // # threads started so far
+  int  next;         // the next morsel to scan
+  int  merged;       // # morsels merged so far
+  bool stop;         // the scan stops early after an error
+  vector<Morsel> results;
+
+  TableScan() : anyOf(NULL), limit(-1) {}
+};
+
+// # threads to scan the given # morsels with: one per core, but not
+// more than the morsels
+static int scanThreads(int morsels)
+{
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  return (int) min((long) min(MAX_SCAN_THREADS, morsels), cores);
+}
+
+// check the conditions of a disjunction: a tuple matches if it meets
+// all conditions of any of the predicates
+static bool matchAny(const vector<Predicate*>& preds, int key, const string& value)
+{
+  for (unsigned i = 0; i < preds.size(); i++) {
+    if (preds[i]->matchKey(key) && preds[i]->matchValue(value)) return true;
+  }
+  return false;
+}
+
+// scan the m'th block of pages of the table
+static RC scanBlock(const TableScan& scan, int m, ScanBuffers& buffers, Morsel& out)
+{
+  RC     rc;
+  int    key;
+  string value;
+
+  if (buffers.block == NULL) {
+    buffers.block = new RecordBlock;
+    buffers.sel = new int[RecordBlock::MAX_RECORDS];
+  }
+  RecordBlock& block = *buffers.block;
+  int* sel = buffers.sel;
+
+  out.count = 0;
+  out.rows.clear();
+  if ((rc = scan.rf->readBlock(m * RecordBlock::MAX_PAGES, RecordBlock::MAX_PAGES, block)) < 0) return rc;
+
+  // a disjunction is checked on each tuple
+  if (scan.anyOf != NULL) {
+    for (int i = 0; i < block.count; i++) {
+      key = block.keys[i];
+      if (scan.readsTable) value.assign(block.values[i]);
+      if (!matchAny(*scan.anyOf, key, value)) continue;
+      out.count++;
+      if (scan.attr != 4) out.rows.push_back(make_pair(key, value));
+    }
+    return 0;
+  }
+
+  // the keys of the block are checked together, and only the tuples
+  // with matching keys are checked further
+  int n = scan.pred->filterKeys(block.keys, block.count, sel);
+  if (scan.attr == 4 && !scan.pred->needsValue()) {
+    out.count = n;
+    return 0;
+  }
+  for (int i = 0; i < n; i++) {
+    key = block.keys[sel[i]];
+    if (scan.readsTable) value.assign(block.values[sel[i]]);
+    if (!scan.pred->matchValue(value)) continue;
+    out.count++;
+    if (scan.attr != 4) out.rows.push_back(make_pair(key, value));
+  }
+  return 0;
+}
+
+// scan the m'th key range of the index
+static RC scanRange(const TableScan& scan, int m, ScanBuffers& buffers, Morsel& out)
+{
+  RC          rc;
+  int         key;
+  string      value;
+  RecordId    rid;
+  IndexCursor ic;
+  vector<pair<int, RecordId> > entries;
+
+  if (scan.fetchByRid && buffers.block == NULL) buffers.block = new RecordBlock;
+
+  int lower = (m == 0) ? scan.lower : scan.splits[m - 1];
+  int upper = (m == scan.morsels - 1) ? scan.upper : scan.splits[m] - 1;
+  out.count = 0;
+  out.rows.clear();
+  buffers.index->locate(lower, ic);
+  while (buffers.index->readForward(ic, key, rid) == 0 && key <= upper) {
+    if (!scan.pred->matchKey(key)) continue;
+    if (scan.fetchByRid) {
+      entries.push_back(make_pair(key, rid));
+      if (entries.size() >= FETCH_BATCH_SIZE &&
+          (rc = fetchTuples(*scan.rf, *scan.pred, scan.attr, NULL, &out.rows, entries,
+                            *buffers.block, out.count)) < 0) return rc;
+      continue;
+    }
+    if (scan.readsTable && (rc = scan.rf->read(rid, key, value)) < 0) return rc;
+    if (!scan.pred->matchValue(value)) continue;
+    out.count++;
+    if (scan.attr != 4) out.rows.push_back(make_pair(key, value));
+  }
+  if (!entries.empty()) {
+    return fetchTuples(*scan.rf, *scan.pred, scan.attr, NULL, &out.rows, entries,
+                       *buffers.block, out.count);
+  }
+  return 0;
+}
+
+// a thread of a parallel scan. it takes the next morsel to scan
+// until all morsels are taken
+static void* scanThread(void* arg)
+{
+  TableScan* scan = (TableScan*) arg;
+  ScanBuffers buffers;
+  Morsel morsel;
+  int m;
+
+  pthread_mutex_lock(&scan->lock);
+  if (!scan->indexes.empty()) buffers.index = scan->indexes[scan->started];
+  scan->started++;
+  for (;;) {
+    while (!scan->stop && scan->next < scan->morsels &&
+           scan->next >= scan->merged + scan->window) {
+      pthread_cond_wait(&scan->changed, &scan->lock);
+    }
+    if (scan->stop || scan->next >= scan->morsels) break;
+    m = scan->next++;
+    pthread_mutex_unlock(&scan->lock);
+
+    morsel.rc = scan->scanMorsel(*scan, m, buffers, morsel);
+
+    pthread_mutex_lock(&scan->lock);
+    scan->results[m].rc = morsel.rc;
+    scan->results[m].count = morsel.count;
+    scan->results[m].rows.swap(morsel.rows);
+    scan->results[m].done = true;
+    pthread_cond_broadcast(&scan->changed);
+  }
+  pthread_mutex_unlock(&scan->lock);
+
+  return NULL;
+}
+
+// scan the morsels of a scan with a pool of threads. the main thread
+// merges the morsels in order: it adds up the counts, and prints the
+// matching tuples to out (or adds them to sorter if given). the scan
+// stops once scan.limit tuples are printed
+static RC runScan(TableScan& scan, ResultSink& out, RowSorter* sorter, int& count)
+{
+  pthread_t threads[MAX_SCAN_THREADS];
+  int       nthreads = 0;
+  Morsel    morsel;
+  RC        rc = 0;
+  int       printed = 0;
+
+  scan.started = scan.next = scan.merged = 0;
+  scan.stop = false;
+  int wanted = scanThreads(scan.morsels);
+  if (wanted > 1) {
+    Morsel empty;
+    empty.done = false;
+    empty.rc = 0;
+    empty.count = 0;
+    scan.results.assign(scan.morsels, empty);
+    scan.window = SCAN_WINDOW * wanted;
+    pthread_mutex_init(&scan.lock, NULL);
+    pthread_cond_init(&scan.changed, NULL);
+    while (nthreads < wanted &&
+           pthread_create(&threads[nthreads], NULL, scanThread, &scan) == 0) {
+      nthreads++;
+    }
+  }
+
+  count = 0;
+  ScanBuffers buffers;
+  if (!scan.indexes.empty()) buffers.index = scan.indexes[0];
+  for (int m = 0; m < scan.morsels; m++) {
+    if (nthreads == 0) {
+      // a single thread scans the morsels itself
+      morsel.rc = scan.scanMorsel(scan, m, buffers, morsel);
+    } else {
+      pthread_mutex_lock(&scan.lock);
+      while (!scan.results[m].done) pthread_cond_wait(&scan.changed, &scan.lock);
+      morsel.rc = scan.results[m].rc;
+      morsel.count = scan.results[m].count;
+      morsel.rows.swap(scan.results[m].rows);
+      scan.merged++;
+      if (morsel.rc < 0) scan.stop = true;
+      pthread_cond_broadcast(&scan.changed);
+      pthread_mutex_unlock(&scan.lock);
+    }
+    if ((rc = morsel.rc) < 0) break;
+
+    count += morsel.count;
+    for (unsigned i = 0; i < morsel.rows.size() && rc == 0; i++) {
+      if (sorter != NULL) {
+        rc = sorter->add(morsel.rows[i].first, morsel.rows[i].second);
+      } else if (scan.limit < 0 || printed++ < scan.limit) {
+        printTuple(out, scan.attr, morsel.rows[i].first, morsel.rows[i].second);
+      }
+    }
+    morsel.rows.clear();
+    if (rc < 0 || (scan.limit >= 0 && sorter == NULL && printed >= scan.limit)) break;
+  }
+
+  // the threads still scanning stop at their next morsel
+  if (nthreads > 0) {
+    pthread_mutex_lock(&scan.lock);
+    scan.stop = true;
+    pthread_cond_broadcast(&scan.changed);
+    pthread_mutex_unlock(&scan.lock);
+  }
+  for (int i = 0; i < nthreads; i++) pthread_join(threads[i], NULL);
+  if (wanted > 1) {
+    pthread_mutex_destroy(&scan.lock);
+    pthread_cond_destroy(&scan.changed);
+  }
+  return rc;
+}
+
+// scan the whole table for the tuples that meet the conditions (or
+// any of the predicates of anyOf, if given), a block of pages at a
+// time on each core. the scan stops once limit tuples are printed
+static RC scanTable(const RecordFile& rf, const Predicate* pred, int attr, bool readsTable,
+                    ResultSink& out, RowSorter* sorter, int limit, int& count,
+                    const vector<Predicate*>* anyOf = NULL)
+{
+  TableScan scan;
+  PageId pages = rf.endRid().pid + (rf.endRid().sid > 0 ? 1 : 0);
+
+  scan.rf = &rf;
+  scan.pred = pred;
+  scan.anyOf = anyOf;
+  scan.attr = attr;
+  scan.readsTable = readsTable;
+  scan.morsels = (pages + RecordBlock::MAX_PAGES - 1) / RecordBlock::MAX_PAGES;
+  scan.scanMorsel = scanBlock;
+  scan.limit = limit;
+  return runScan(scan, out, sorter, count);
+}
+
+// print the tuples of a RowSorter in order, and tell in the plan how
+// they were sorted
+static RC printSorted(RowSorter& sorter, ResultSink& out, int attr, int limit)
+{
+  RC     rc;
+  int    key;
+  string value;
+
+  if ((rc = sorter.sort()) < 0) return rc;
+  while ((rc = sorter.readNext(key, value)) == 0) {
+    printTuple(out, attr, key, value);
+  }
+  if (sorter.spilled()) plan += ", external sort";
+  else plan += (limit >= 0) ? ", top-k sort" : ", sort";
+  return (rc == RC_END_OF_TREE) ? 0 : rc;
+}
+
+// print the groups of "SELECT value, COUNT(*) ... GROUP BY value", up
+// to limit groups, sorted if ORDER BY value is given
+static RC printGroups(ResultSink& out, int order, int limit, const string& table)
+{
+  RC     rc;
+  string value;
+  int    count;
+  int    printed = 0;
+
+  if ((rc = groups->finish()) < 0) return rc;
+  plan += groups->spilled() ? ", hash aggregation in partitions" : ", hash aggregation";
+
+  // the groups are sorted with the count as their key
+  if (order != SqlEngine::UNORDERED) {
+    RowSorter sorter(rowOrder(order), limit, table + ".sort");
+    while ((rc = groups->readNext(value, count)) == 0) {
+      if ((rc = sorter.add(count, value)) < 0) return rc;
+    }
+    if (rc != RC_END_OF_TREE) return rc;
+    if ((rc = sorter.sort()) < 0) return rc;
+    while ((rc = sorter.readNext(count, value)) == 0) printGroup(out, value, count);
+    return (rc == RC_END_OF_TREE) ? 0 : rc;
+  }
+
+  while ((limit < 0 || printed++ < limit) && (rc = groups->readNext(value, count)) == 0) {
+    printGroup(out, value, count);
+  }
+  return (rc == RC_END_OF_TREE) ? 0 : rc;
+}
+
+RC SqlEngine::select(int attr, const string& table, const vector<SelCond>& cond, int order, int limit)
+{
+  RecordFile* rf = NULL;   // RecordFile containing the table, kept open by the Catalog
+  RecordId   rid;  // record cursor for table scanning
+  BTreeIndex* bti = NULL;  // BTreeIndex for table, kept open by the Catalog
+  bool useBTree = false;
+  int lower = INT_MIN, upper = INT_MAX;
+  IndexCursor ic;
+  LSMTree    lsm;  // LSMTree for table, used when the table has no BTreeIndex
+  LSMCursor  lc;
+  bool useLSM = false;
+  HashIndex* hi = NULL;  // HashIndex for table, used for key equality lookups,
+                         // kept open by the Catalog
+  Predicate  pred; // the conditions compiled for the query
+  ResultSink out(outputFile != NULL ? outputFile : stdout,
+                 outputFormat == BINARY_OUTPUT, attr);  // the buffered output of the query
+  vector<int> probes;
+  TableScan  scan;  // a key range scanned in parallel
+  vector<pair<int, RecordId> > found;  // index entries collected by the probes
+  vector<pair<int, RecordId> > pending;  // index entries to read from the table
+  RecordBlock* block = NULL;  // the table page read for the pending entries
+  bool fetchByRid;  // the tuples are read from the table in RecordId order
+  bool useFound = false;
+  unsigned next = 0;
+  bool backward;    // walk the index from the right
+  bool firstOnly;   // the first matching tuple is the result (MIN or MAX)
+  bool sortOutput = false;  // the tuples are sorted by sorter before they are printed
+  RowSorter sorter(rowOrder(order), limit, table + ".sort");
+  bool keyOrder;    // ORDER BY key, which an index scan delivers
+  int  groupOrder = order;  // the ORDER BY and LIMIT of the groups of GROUP BY value
+  int  groupLimit = limit;
+  const TableStats* stats = NULL;  // the statistics of ANALYZE, if any
+  bool useStats = false;
+  bool readsTable;  // the index alone cannot answer the query
+  bool fetched;     // the value of the tuple has been read
+  double estimated = 0;
+
+  RC     rc;
+  int    key;     
+  string value;
+  int    count;
+  char   buf[64];
+
+  // open the table file
+  if ((rc = Catalog::getTable(table, rf)) < 0) {
+    fprintf(stderr, "Error: table %s does not exist\n", table.c_str());
+    out.finish();
+    return rc;
+  }
+
+  // the aggregates do not depend on the order of the tuples, and their
+  // single result tuple is not limited. MIN(key) is the first matching
+  // key from the left end of the key range, and MAX(key) from the right end.
+  // GROUP BY value counts the tuples of each value in a HashAggregate,
+  // and the ORDER BY and LIMIT apply to the groups
+  if (attr == 9) groups = new HashAggregate(table + ".group");
+  if (attr >= 4) {
+    order = UNORDERED;
+    limit = -1;
+  }
+  backward = (order == DESCENDING || attr == 6);
+  firstOnly = (attr == 5 || attr == 6);
+  keyOrder = (order == ASCENDING || order == DESCENDING);
+  sortOutput = (order == VALUE_ASCENDING || order == VALUE_DESCENDING);
+
+  // parse the constants once, and find the key range of the conditions.
+  // a contradiction is answered without reading the table
+  pred.compile(cond);
+  lower = pred.getLower();
+  upper = pred.getUpper();
+  readsTable = (attr == 2 || attr == 3 || attr == 9 || pred.needsValue());
+  fetchByRid = (readsTable && order == UNORDERED && !firstOnly && limit < 0);
+  if (pred.isFalse() || limit == 0) {
+    plan = (limit == 0) ? "LIMIT 0 prints no tuple" : "no tuple can match the conditions";
+    if (attr == 4) printCount(out, 0);
+    if (attr > 4 && attr < 9) out.putAggregate();
+    rc = 0;
+    goto exit_select;
+  }
+
+  // without a WHERE clause, COUNT(*) is the # tuples of the table
+  if (cond.empty() && attr == 4) {
+    plan = "row count of the table file";
+    printCount(out, rf->recordCount());
+    rc = 0;
+    goto exit_select;
+  }
+
+  // open BTreeIndex file (or LSMTree files) and check condition for BTree search
+  if ((rc = Catalog::getIndex(table, bti)) < 0 &&
+      (rc = lsm.open(table + ".lsm", 'r')) == 0) {
+    useLSM = true;
+  }
+  if (rc == 0) {
+    // without a WHERE clause, MIN(key) or MAX(key) is kept in the header
+    // page of the BTreeIndex, unless the index is older than the header
+    if (!useLSM && cond.empty() && (attr == 5 || attr == 6)) {
+      if ((rc = bti->getKeyRange(lower, upper)) != RC_NO_SUCH_RECORD) {
+        plan = (attr == 5) ? "smallest key in the index header" : "largest key in the index header";
+        if (rc == 0) out.addKey(attr == 5 ? lower : upper);
+        out.putAggregate();
+        rc = 0;
+        goto exit_select;
+      }
+      rc = 0;
+    }
+
+    // only the conditions on key narrow down the index range.
+    // the index also delivers the tuples in key order
+    useBTree = (pred.hasKeyRange() || pred.hasKeyList() || (attr >= 4 && attr < 9) || keyOrder);
+
+    // LSMTree is only read forward. MAX(key) reads the whole range
+    if (useLSM && backward) {
+      if (attr < 4) sortOutput = true;
+      if (attr == 6) firstOnly = false;
+    }
+
+    // IN conditions on key probe the BTreeIndex with locateMany().
+    // an equality condition on key goes to the HashIndex if there is one.
+    if (pred.hasKeyList() && !useLSM) {
+      probes = pred.getKeys();
+      useFound = true;
+    } else if (lower == upper && useBTree && !useLSM) {
+      probes.push_back(lower);
+    }
+
+    // with the statistics of ANALYZE, a key range is read with the plan
+    // estimated to read fewer pages. a heap scan reads every table page.
+    // an index scan reads the leaf nodes in the range, and a table page
+    // each time the next tuple is on another page, unless it only needs keys.
+    // ORDER BY key with a LIMIT stops the index scan early, and is not costed
+    if (!useLSM && !useFound && probes.empty() && !firstOnly && !(keyOrder && limit >= 0) &&
+        Catalog::getStats(table, stats) == 0) {
+      double fraction = 0;
+      estimated = stats->estimate(lower, upper);
+      if (stats->getRowCount() > 0) fraction = estimated / stats->getRowCount();
+      double indexCost = 1 + fraction * stats->getLeafCount();
+      if (readsTable) indexCost += fraction * stats->getFetchCount();
+      useBTree = (stats->getLeafCount() > 0 && indexCost < stats->getPageCount());
+      useStats = true;
+    }
+  }
+
+  plan = useBTree ? (readsTable ? "index range scan" : "index-only scan") : "heap scan";
+  if (useBTree && firstOnly) {
+    plan = (attr == 5) ? "index lookup of the smallest key" : "index lookup of the largest key";
+  }
+  if (useStats) {
+    sprintf(buf, ", estimated %.0f of %d tuples", estimated, stats->getRowCount());
+    plan += buf;
+  }
+
+  // a wide key range is split at the separator keys of the index, and
+  // the sub-ranges are scanned in parallel, each with its own cursor
+  if (useBTree && !useLSM && !useFound && probes.empty() && !backward && !firstOnly &&
+      scanThreads(INT_MAX) > 1 &&
+      bti->splitRange(lower, upper, scanThreads(INT_MAX) * SCAN_WINDOW, scan.splits) == 0 &&
+      !scan.splits.empty() &&
+      Catalog::getScanIndexes(table, scanThreads(scan.splits.size() + 1), scan.indexes) == 0) {
+    scan.rf = rf;
+    scan.pred = &pred;
+    scan.attr = attr;
+    scan.readsTable = readsTable;
+    scan.morsels = scan.splits.size() + 1;
+    scan.scanMorsel = scanRange;
+    scan.fetchByRid = fetchByRid;
+    scan.lower = lower;
+    scan.upper = upper;
+    scan.limit = sortOutput ? -1 : limit;
+    sprintf(buf, ", %d key ranges", scan.morsels);
+    plan = "parallel " + plan + buf;
+    if ((rc = runScan(scan, out, sortOutput ? &sorter : NULL, count)) < 0) {
+      fprintf(stderr, "Error: while reading the index of table %s\n", table.c_str());
+      goto exit_select;
+    }
+    if (attr == 4) {
+      printCount(out, count);
+    }
+  }
+  else if (useBTree){
+    count = 0;
+    if (!useFound && !probes.empty() && Catalog::getHashIndex(table, hi) == 0) {
+      plan = "hash index lookup";
+      // one directory page and one bucket page read
+      vector<RecordId> rids;
+      if ((rc = hi->lookup(lower, rids)) < 0) {
+        fprintf(stderr, "Error: while reading the index of table %s\n", table.c_str());
+        goto exit_select;
+      }
+      for (unsigned j = 0; j < rids.size(); j++) {
+        found.push_back(make_pair(lower, rids[j]));
+      }
+      useFound = true;
+    } else if (useFound) {
+      plan = "index lookup of the IN list";
+      // look up all keys in the IN list with a single walk of the tree
+      if ((rc = bti->locateMany(probes, found)) < 0) {
+        fprintf(stderr, "Error: while reading the index of table %s\n", table.c_str());
+        goto exit_select;
+      }
+    } else if (useLSM) {
+      plan = "LSM tree range scan";
+      lsm.locate(lower, lc);
+    } else if (backward) {
+      bti->locateLast(upper, ic);
+    } else {
+      bti->locate(lower, ic);
+    }
+
+    if (fetchByRid) block = new RecordBlock;
+    for (;;) {
+      // read the next index entry
+      if (useFound) {
+        rc = (next < found.size()) ? 0 : RC_END_OF_TREE;
+        if (rc == 0) {
+          unsigned j = backward ? found.size() - 1 - next : next;
+          key = found[j].first; rid = found[j].second; next++;
+        }
+      } else if (useLSM) {
+        rc = lsm.readForward(lc, key, rid);
+      } else if (backward) {
+        rc = bti->readBackward(ic, key, rid);
+      } else {
+        rc = bti->readForward(ic, key, rid);
+      }
+      if (rc != 0 || key > upper || key < lower) break;
+
+      // check the conditions on key first, and read the tuple only
+      // if the conditions on value need it
+      if (!pred.matchKey(key)) goto next_tuple_BTree;
+
+      // the tuples of an unordered query are read from the table in
+      // batches, in RecordId order
+      if (fetchByRid) {
+        pending.push_back(make_pair(key, rid));
+        if (pending.size() >= FETCH_BATCH_SIZE &&
+            (rc = fetchTuples(*rf, pred, attr, &out, NULL, pending, *block, count)) < 0) {
+          fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+          goto exit_select;
+        }
+        goto next_tuple_BTree;
+      }
+
+      fetched = false;
+      if (pred.needsValue()) {
+        if ((rc = rf->read(rid, key, value)) < 0) {
+          fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+          goto exit_select;
+        }
+        fetched = true;
+        if (!pred.matchValue(value)) goto next_tuple_BTree;
+      }
+
+      // the condition is met for the tuple. 
+      // increase matching tuple counter
+      count++;
+
+      // read the value to print
+      if ((attr == 2 || attr == 3 || attr == 9) && !fetched && (rc = rf->read(rid, key, value)) < 0) {
+        fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+        goto exit_select;
+      }
+      if (sortOutput) {
+        if ((rc = sorter.add(key, value)) < 0) {
+          fprintf(stderr, "Error: while sorting the tuples of table %s\n", table.c_str());
+          goto exit_select;
+        }
+        goto next_tuple_BTree;
+      }
+
+      // print the tuple, and stop at the LIMIT
+      printTuple(out, attr, key, value);
+      if (firstOnly || count == limit) break;
+
+      // move to the next tuple
+      next_tuple_BTree:
+        ;
+    }
+    if (!pending.empty() &&
+        (rc = fetchTuples(*rf, pred, attr, &out, NULL, pending, *block, count)) < 0) {
+      fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+      goto exit_select;
+    }
+
+    // print matching tuple count if "select count(*)"
+    if (attr == 4) {
+      printCount(out, count);
+    }
+    rc = 0;
+  }
+  else {
+
+    // scan the table file, a block of pages at a time on each core.
+    // without an index, ORDER BY sorts the matching tuples at the end
+    sortOutput = (order != UNORDERED);
+    if ((rc = scanTable(*rf, &pred, attr, readsTable, out, sortOutput ? &sorter : NULL,
+                        limit, count)) < 0) {
+      fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+      goto exit_select;
+    }
+
+    // print matching tuple count if "select count(*)"
+    if (attr == 4) {
+      printCount(out, count);
+    }
+    rc = 0;
+
+    // close the table file and return
+  }
+
+  // print the tuples collected for ORDER BY
+  if (sortOutput && (rc = printSorted(sorter, out, attr, limit)) < 0) {
+    fprintf(stderr, "Error: while sorting the tuples of table %s\n", table.c_str());
+    goto exit_select;
+  }
+
+  // print the result of "select min(key)" and the other aggregates
+  if (attr == 9) {
+    if ((rc = printGroups(out, groupOrder, groupLimit, table)) < 0) {
+      fprintf(stderr, "Error: while grouping the tuples of table %s\n", table.c_str());
+      goto exit_select;
+    }
+  } else if (attr > 4) {
+    out.putAggregate();
+  }
+
+  exit_select:
+  out.finish();
+  delete block;
+  delete groups;
+  groups = NULL;
+  if (useLSM) lsm.close();
+  return rc;
+
+}
+
+RC SqlEngine::select(int attr, const string& table, const vector<vector<SelCond> >& disjuncts,
+                     int order, int limit)
+{
+  RecordFile* rf = NULL;   // RecordFile containing the table, kept open by the Catalog
+  BTreeIndex* bti = NULL;  // BTreeIndex for table, kept open by the Catalog
+  IndexCursor ic;
+  vector<Predicate*> preds;  // the disjuncts that may match a tuple
+  vector<unsigned> live;     // their positions in disjuncts
+  ResultSink out(outputFile != NULL ? outputFile : stdout,
+                 outputFormat == BINARY_OUTPUT, attr);
+  vector<pair<int, RecordId> > found;  // the index entries of all disjuncts
+  RecordBlock* block = NULL;
+  bool indexable = true;  // every disjunct narrows the key range
+  bool useBTree = false;
+  bool readsTable;
+  bool sortOutput;
+  int  groupOrder;  // the ORDER BY and LIMIT of the groups of GROUP BY value
+  int  groupLimit;
+
+  RC       rc = 0;
+  int      key;
+  RecordId rid;
+  PageId   pid = -1;  // the table page in block
+  string   value;
+  int      count = 0;
+  char     buf[64];
+
+  if (disjuncts.size() == 1) return select(attr, table, disjuncts[0], order, limit);
+
+  // the tuples are found in RecordId order, and sorted for ORDER BY
+  groupOrder = order;
+  groupLimit = limit;
+  if (attr >= 4) {
+    order = UNORDERED;
+    limit = -1;
+  }
+  sortOutput = (order != UNORDERED);
+  RowSorter sorter(rowOrder(order), limit, table + ".sort");
+
+  if ((rc = Catalog::getTable(table, rf)) < 0) {
+    fprintf(stderr, "Error: table %s does not exist\n", table.c_str());
+    out.finish();
+    return rc;
+  }
+
+  // compile each disjunct, and drop those that match no tuple
+  for (unsigned i = 0; i < disjuncts.size(); i++) {
+    Predicate* pred = new Predicate;
+    pred->compile(disjuncts[i]);
+    if (pred->isFalse()) {
+      delete pred;
+      continue;
+    }
+    if (!pred->hasKeyRange() && !pred->hasKeyList()) indexable = false;
+    preds.push_back(pred);
+    live.push_back(i);
+  }
+
+  // a single disjunct left is a plain conjunction
+  if (preds.size() == 1) {
+    delete preds[0];
+    out.finish();
+    return select(attr, table, disjuncts[live[0]], groupOrder, groupLimit);
+  }
+  if (attr == 9) groups = new HashAggregate(table + ".group");
+  if (preds.empty() || limit == 0) {
+    plan = (limit == 0) ? "LIMIT 0 prints no tuple" : "no tuple can match the conditions";
+    if (attr == 4) printCount(out, 0);
+    if (attr > 4 && attr < 9) out.putAggregate();
+    goto exit_select;
+  }
+
+  readsTable = (attr == 2 || attr == 3 || attr == 9);
+  for (unsigned i = 0; i < preds.size(); i++) {
+    if (preds[i]->needsValue()) readsTable = true;
+  }
+
+  // a disjunct without a key range would read the whole index, so the
+  // table is scanned once for all disjuncts
+  useBTree = (indexable && Catalog::getIndex(table, bti) == 0);
+  if (!useBTree) {
+    plan = "heap scan of a disjunction";
+    if ((rc = scanTable(*rf, NULL, attr, readsTable, out, sortOutput ? &sorter : NULL,
+                        limit, count, &preds)) < 0) {
+      fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+      goto exit_select;
+    }
+    goto print_select;
+  }
+
+  // collect the index entries of each disjunct. a tuple matching
+  // several disjuncts is found once per disjunct, so the entries are
+  // sorted by RecordId and the duplicates dropped
+  sprintf(buf, "index union of %d key ranges", (int) preds.size());
+  plan = buf;
+  for (unsigned i = 0; i < preds.size(); i++) {
+    const Predicate& pred = *preds[i];
+    if (pred.hasKeyList()) {
+      // locateMany() replaces the entries it is given, so those of the
+      // disjuncts before are kept apart
+      vector<int> probes = pred.getKeys();
+      vector<pair<int, RecordId> > entries;
+      if ((rc = bti->locateMany(probes, entries)) < 0) {
+        fprintf(stderr, "Error: while reading the index of table %s\n", table.c_str());
+        goto exit_select;
+      }
+      found.insert(found.end(), entries.begin(), entries.end());
+      continue;
+    }
+    bti->locate(pred.getLower(), ic);
+    while (bti->readForward(ic, key, rid) == 0 && key <= pred.getUpper()) {
+      if (pred.matchKey(key)) found.push_back(make_pair(key, rid));
+    }
+  }
+  sort(found.begin(), found.end(), lessRid);
+
+  // read each table page once, and check the tuple against all disjuncts
+  if (readsTable) block = new RecordBlock;
+  for (unsigned i = 0; i < found.size(); i++) {
+    if (i > 0 && found[i].second == found[i - 1].second) continue;
+    key = found[i].first;
+    rid = found[i].second;
+    if (readsTable) {
+      if (rid.pid != pid) {
+        if ((rc = rf->readBlock(rid.pid, 1, *block)) < 0) {
+          fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+          goto exit_select;
+        }
+        pid = rid.pid;
+      }
+      if (rid.sid < 0 || rid.sid >= block->count) {
+        rc = RC_INVALID_RID;
+        fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+        goto exit_select;
+      }
+      value.assign(block->values[rid.sid]);
+    }
+    if (!matchAny(preds, key, value)) continue;
+    count++;
+    if (sortOutput) {
+      if ((rc = sorter.add(key, value)) < 0) {
+        fprintf(stderr, "Error: while sorting the tuples of table %s\n", table.c_str());
+        goto exit_select;
+      }
+      continue;
+    }
+    printTuple(out, attr, key, value);
+    if (count == limit) break;
+  }
+
+  print_select:
+  if (attr == 4) printCount(out, count);
+  if (attr > 4 && attr < 9) out.putAggregate();
+  if (attr == 9 && (rc = printGroups(out, groupOrder, groupLimit, table)) < 0) {
+    fprintf(stderr, "Error: while grouping the tuples of table %s\n", table.c_str());
+    goto exit_select;
+  }
+  if (sortOutput && (rc = printSorted(sorter, out, attr, limit)) < 0) {
+    fprintf(stderr, "Error: while sorting the tuples of table %s\n", table.c_str());
+    goto exit_select;
+  }
+  rc = 0;
+
+  exit_select:
+  out.finish();
+  delete block;
+  for (unsigned i = 0; i < preds.size(); i++) delete preds[i];
+  delete groups;
+  groups = NULL;
+  return rc;
+}
+
+RC SqlEngine::setOutput(int format, const string& filename)
+{
+  FILE* file = NULL;
+
+  if (!filename.empty() && (file = fopen(filename.c_str(), "ab")) == NULL) {
+    fprintf(stderr, "Error: file %s cannot be opened\n", filename.c_str());
+    return RC_FILE_OPEN_FAILED;
+  }
+  if (outputFile != NULL) fclose(outputFile);
+  outputFile = file;
+  outputFormat = format;
+  return 0;
+}
+
+const char* SqlEngine::getPlan()
+{
+  return plan.c_str();
+}
+
+RC SqlEngine::load(const string& table, const string& loadfile, int index)
+{
+  /* your code here */
+  RecordFile rf;   // RecordFile containing the table
+  RecordId   rid;  // record cursor for table scanning
+
+  BTreeIndex bti;
+  LSMTree    lsm;
+  HashIndex  hi;
+  vector<pair<int, RecordId> > batch;
+  bool useBTree = (index == BTREE_INDEX || index == HASH_INDEX || index == LEARNED_INDEX);
+  bool useHash;
+
+  RC     rc;
+  int    key;     
+  string value;
+
+  // the handles kept by the Catalog would keep stale pages in the read
+  // cache, as the cache only drops the pages written through the same file
+  Catalog::drop(table);
+
+  // open the table file
+  if ((rc = rf.open(table + ".tbl", 'w')) < 0) {
+    fprintf(stderr, "Error: table %s cannot be opened\n", table.c_str());
+    return rc;
+  }
+
+  // the statistics no longer match the table
+  ::unlink((table + ".stat").c_str());
+
+  if (useBTree && (rc= bti.open(table+ ".idx", 'w'))<0){
+    fprintf(stderr, "Error: Index BTree cannot be created for table %s\n", table.c_str());
+    return rc;
+  }
+
+  // select() sends key equality lookups to the HashIndex whenever the
+  // table has one, so an existing HashIndex grows with every load that
+  // adds to the BTreeIndex. any other load would leave it stale
+  useHash = (index == HASH_INDEX || (useBTree && ::access((table + ".hidx").c_str(), F_OK) == 0));
+  if (!useHash) ::unlink((table + ".hidx").c_str());
+
+  if (useHash && (rc= hi.open(table+ ".hidx", 'w'))<0){
+    fprintf(stderr, "Error: Index Hash cannot be created for table %s\n", table.c_str());
+    return rc;
+  }
+
+  if (index == LSM_INDEX && (rc= lsm.open(table+ ".lsm", 'w'))<0){
+    fprintf(stderr, "Error: Index LSMTree cannot be created for table %s\n", table.c_str());
+    return rc;
+  }
+
+  ifstream infile;
+  infile.open(loadfile.c_str());
+  string line;
+
+  while(getline(infile, line)){
+    if (rc=(parseLoadLine(line, key, value))<0){
+      return rc;
+    }
+    // fprintf(stdout, "Load %s\n", value.c_str());
+
+    if ((rc=rf.append(key, value, rid))<0){
+      return rc;
+    }
+    
+    if (index == LSM_INDEX && (rc=lsm.insert(key, rid))<0){
+      return rc;
+    }
+
+    if (useHash && (rc=hi.insert(key, rid))<0){
+      return rc;
+    }
+
+    if (useBTree){
+      batch.push_back(make_pair(key, rid));
+      // the learned model works best when all leaf nodes are written
+      // by a single batch, on consecutive pages
+      if (batch.size() >= LOAD_BATCH_SIZE && index != LEARNED_INDEX){
+        if ((rc=bti.insertBatch(batch))<0) return rc;
+        batch.clear();
+      }
+    }
+  }
+  if (useBTree && (rc=bti.insertBatch(batch))<0){
+    return rc;
+  }
+  if (index == LEARNED_INDEX && (rc=bti.buildModel())<0){
+    return rc;
+  }
+  infile.close();
+  rf.close();
+  if (useBTree)bti.close();
+  if (useHash)hi.close();
+  if (index == LSM_INDEX)lsm.close();
+
+  return 0;
+}
+
+// order for the tuples sorted by cluster()
+static bool lessKey(const pair<int, string>& a, const pair<int, string>& b)
+{
+  return a.first < b.first;
+}
+
+// sort the tuples by key and write them to the new RecordFile name
+static RC writeSortedRun(vector<pair<int, string> >& tuples, const string& name, RecordFile& run)
+{
+  RC rc;
+  RecordId rid;
+
+  stable_sort(tuples.begin(), tuples.end(), lessKey);
+  ::unlink(name.c_str());
+  if ((rc = run.open(name, 'w')) < 0) return rc;
+  for (unsigned i = 0; i < tuples.size(); i++) {
+    if ((rc = run.append(tuples[i].first, tuples[i].second, rid)) < 0) return rc;
+  }
+  tuples.clear();
+  return run.close();
+}
+
+RC SqlEngine::cluster(const string& table)
+{
+  RecordFile rf;   // RecordFile containing the table
+  RecordFile out;  // the table rewritten in key order
+  RecordId   rid;  // record cursor for table scanning
+  BTreeIndex bti;  // the new BTreeIndex, if the table has one
+  HashIndex  hi;   // the new HashIndex, if the table has one
+  bool hasBTree, hasHash, learned = false;
+
+  vector<pair<int, string> > tuples;  // the tuples sorted in memory
+  vector<RecordFile*> runs;           // the sorted runs on disk
+  vector<RecordId> cursors;           // the next tuple of each run
+  priority_queue<pair<int, int>, vector<pair<int, int> >, greater<pair<int, int> > > heads;
+  vector<pair<int, RecordId> > batch;
+
+  RC     rc;
+  int    key;
+  string value;
+  char   suffix[16];
+
+  // the files of the table are replaced. the handles kept by the
+  // Catalog are closed, and their pages leave the read cache
+  Catalog::drop(table);
+
+  // open the table file
+  if ((rc = rf.open(table + ".tbl", 'r')) < 0) {
+    fprintf(stderr, "Error: table %s does not exist\n", table.c_str());
+    return rc;
+  }
+
+  // find the indexes that have to be rebuilt. the runs of an LSMTree
+  // cannot be rebuilt in place, and an LSM index is meant for tables
+  // that keep growing anyway
+  {
+    BTreeIndex oldBTree;
+    HashIndex  oldHash;
+    LSMTree    oldLSM;
+    if (oldLSM.open(table + ".lsm", 'r') == 0) {
+      oldLSM.close();
+      rf.close();
+      fprintf(stderr, "Error: table %s has an LSM index and cannot be clustered\n", table.c_str());
+      return RC_INVALID_FILE_MODE;
+    }
+    if ((hasBTree = (oldBTree.open(table + ".idx", 'r') == 0))) {
+      learned = oldBTree.hasModel();
+      oldBTree.close();
+    }
+    if ((hasHash = (oldHash.open(table + ".hidx", 'r') == 0))) {
+      oldHash.close();
+    }
+  }
+
+  // sort the table in runs of CLUSTER_RUN_SIZE tuples. a table that
+  // fits in memory is sorted in place without writing any run
+  rid.pid = rid.sid = 0;
+  while (rid < rf.endRid()) {
+    if ((rc = rf.read(rid, key, value)) < 0) {
+      fprintf(stderr, "Error: while reading a tuple from table %s\n", table.c_str());
+      goto exit_cluster;
+    }
+    tuples.push_back(make_pair(key, value));
+    ++rid;
+
+    if (tuples.size() >= CLUSTER_RUN_SIZE || (!runs.empty() && !(rid < rf.endRid()))) {
+      sprintf(suffix, ".%d", (int)runs.size());
+      runs.push_back(new RecordFile);
+      if ((rc = writeSortedRun(tuples, table + ".tbl" + suffix, *runs.back())) < 0) {
+        fprintf(stderr, "Error: while sorting table %s\n", table.c_str());
+        goto exit_cluster;
+      }
+    }
+  }
+  stable_sort(tuples.begin(), tuples.end(), lessKey);
+
+  // write the new table and indexes next to the old ones
+  ::unlink((table + ".tbl.new").c_str());
+  ::unlink((table + ".idx.new").c_str());
+  ::unlink((table + ".hidx.new").c_str());
+  if ((rc = out.open(table + ".tbl.new", 'w')) < 0 ||
+      (hasBTree && (rc = bti.open(table + ".idx.new", 'w')) < 0) ||
+      (hasHash && (rc = hi.open(table + ".hidx.new", 'w')) < 0)) {
+    fprintf(stderr, "Error: the clustered table %s cannot be created\n", table.c_str());
+    goto exit_cluster;
+  }
+
+  // merge the runs. on equal keys, the run read first comes first, so
+  // that the tuples with the same key stay in their old order
+  for (unsigned i = 0; i < runs.size(); i++) {
+    sprintf(suffix, ".%d", i);
+    if ((rc = runs[i]->open(table + ".tbl" + suffix, 'r')) < 0) goto exit_cluster;
+    cursors.push_back(RecordId());
+    cursors[i].pid = cursors[i].sid = 0;
+    if ((rc = runs[i]->read(cursors[i], key, value)) < 0) goto exit_cluster;
+    heads.push(make_pair(key, i));
+  }
+  for (unsigned next = 0; next < tuples.size() || !heads.empty(); ) {
+    if (runs.empty()) {
+      key = tuples[next].first;
+      value = tuples[next++].second;
+    } else {
+      int i = heads.top().second;
+      heads.pop();
+      if ((rc = runs[i]->read(cursors[i], key, value)) < 0) goto exit_cluster;
+      if (++cursors[i] < runs[i]->endRid()) {
+        int nextKey;
+        string nextValue;
+        if ((rc = runs[i]->read(cursors[i], nextKey, nextValue)) < 0) goto exit_cluster;
+        heads.push(make_pair(nextKey, i));
+      }
+    }
+
+    if ((rc = out.append(key, value, rid)) < 0) {
+      fprintf(stderr, "Error: while writing the clustered table %s\n", table.c_str());
+      goto exit_cluster;
+    }
+    if (hasHash && (rc = hi.insert(key, rid)) < 0) goto exit_cluster;
+    if (hasBTree) {
+      // the keys arrive in order, so each batch extends the right edge of the tree
+      batch.push_back(make_pair(key, rid));
+      if (batch.size() >= LOAD_BATCH_SIZE && !learned) {
+        if ((rc = bti.insertBatch(batch)) < 0) goto exit_cluster;
+        batch.clear();
+      }
+    }
+  }
+  if (hasBTree && (rc = bti.insertBatch(batch)) < 0) goto exit_cluster;
+  if (learned && (rc = bti.buildModel()) < 0) goto exit_cluster;
+
+  // replace the old table and indexes
+  rf.close();
+  out.close();
+  if (hasBTree) bti.close();
+  if (hasHash) hi.close();
+  if (::rename((table + ".tbl.new").c_str(), (table + ".tbl").c_str()) < 0 ||
+      (hasBTree && ::rename((table + ".idx.new").c_str(), (table + ".idx").c_str()) < 0) ||
+      (hasHash && ::rename((table + ".hidx.new").c_str(), (table + ".hidx").c_str()) < 0)) {
+    fprintf(stderr, "Error: the clustered table %s cannot replace the old one\n", table.c_str());
+    rc = RC_FILE_WRITE_FAILED;
+  }
+  ::unlink((table + ".stat").c_str());
+  hasBTree = hasHash = false;
+
+  exit_cluster:
+  for (unsigned i = 0; i < runs.size(); i++) {
+    sprintf(suffix, ".%d", i);
+    runs[i]->close();
+    ::unlink((table + ".tbl" + suffix).c_str());
+    delete runs[i];
+  }
+  if (rc < 0) {
+    rf.close();
+    out.close();
+    if (hasBTree) bti.close();
+    if (hasHash) hi.close();
+    ::unlink((table + ".tbl.new").c_str());
+    ::unlink((table + ".idx.new").c_str());
+    ::unlink((table + ".hidx.new").c_str());
+  }
+  return rc;
+}
+
+RC SqlEngine::analyze(const string& table)
+{
+  TableStats stats;
+  RC rc;
+
+  if ((rc = stats.compute(table)) < 0) {
+    fprintf(stderr, "Error: table %s cannot be analyzed\n", table.c_str());
+    return rc;
+  }
+  // the statistics kept by the Catalog are read again
+  Catalog::drop(table);
+  if ((rc = stats.write(table)) < 0) {
+    fprintf(stderr, "Error: the statistics of table %s cannot be saved\n", table.c_str());
+    return rc;
+  }
+
+  return 0;
+}
+
+// print a tuple of "SELECT key" or "SELECT *" on a join. the values of
+// both tables are printed, in the order of the FROM clause. in binary
+// output the two values are separated by a '\0'
+static void printJoined(ResultSink& out, int attr, int key, const string& left,
+                        const string& right)
+{
+  if (attr == 4) return;  // "SELECT COUNT(*)" prints the count only
+  if (out.isBinary()) {
+    out.putRow(key, attr == 3 ? left + '\0' + right : string());
+    return;
+  }
+  out.putInt(key);
+  if (attr == 3) {
+    out.putString(" '", 2);
+    out.putString(left);
+    out.putString("' '", 3);
+    out.putString(right);
+    out.putString("'\n", 2);
+    return;
+  }
+  out.putChar('\n');
+}
+
+// # pages of a table
+static PageId pageCount(const RecordFile& rf)
+{
+  return rf.endRid().pid + (rf.endRid().sid > 0 ? 1 : 0);
+}
+
+// the hash of a join key. the low bits choose the partition of a
+// partitioned hash join, and the high bits the bucket within it
+static unsigned hashKey(int key)
+{
+  unsigned h = (unsigned) key * 2654435761u;
+  return h ^ (h >> 16);
+}
+
+// the order of the positions of index entries by RecordId, for reading
+// the tuples of the entries page by page
+struct EntryRidOrder {
+  const vector<pair<int, RecordId> >* entries;
+
+  bool operator()(unsigned a, unsigned b) const
+  {
+    return (*entries)[a].second < (*entries)[b].second;
+  }
+};
+
+// join a batch of tuples of the outer table with the inner table. the
+// batch is sorted by key, and all its keys are looked up with a single
+// walk of the inner index. the inner tuples are read in RecordId order
+// if their values are printed. the batch is cleared
+static RC probeBatch(vector<pair<int, string> >& batch, const RecordFile& inner,
+                     BTreeIndex& index, bool outerIsLeft, int attr, ResultSink& out,
+                     RecordBlock& block, int& count)
+{
+  RC     rc;
+  vector<int> keys;
+  vector<pair<int, RecordId> > entries;
+  vector<string> values;  // the values of the inner tuples of entries
+  string none;
+
+  stable_sort(batch.begin(), batch.end(), lessKey);
+  for (unsigned i = 0; i < batch.size(); i++) keys.push_back(batch[i].first);
+  if ((rc = index.locateMany(keys, entries)) < 0) return rc;
+
+  if (attr == 3) {
+    vector<unsigned> order(entries.size());
+    EntryRidOrder byRid;
+    PageId pid = -1;
+
+    for (unsigned i = 0; i < order.size(); i++) order[i] = i;
+    byRid.entries = &entries;
+    sort(order.begin(), order.end(), byRid);
+    values.resize(entries.size());
+    for (unsigned i = 0; i < order.size(); i++) {
+      const RecordId& rid = entries[order[i]].second;
+      if (rid.pid != pid) {
+        if ((rc = inner.readBlock(rid.pid, 1, block)) < 0) return rc;
+        pid = rid.pid;
+      }
+      if (rid.sid < 0 || rid.sid >= block.count) return RC_INVALID_RID;
+      values[order[i]].assign(block.values[rid.sid]);
+    }
+  }
+
+  // merge the batch and the entries, both in key order
+  unsigned i = 0, j = 0;
+  while (i < batch.size() && j < entries.size()) {
+    int key = batch[i].first;
+    if (key < entries[j].first) { i++; continue; }
+    if (key > entries[j].first) { j++; continue; }
+    unsigned first = j;
+    for (; i < batch.size() && batch[i].first == key; i++) {
+      for (j = first; j < entries.size() && entries[j].first == key; j++) {
+        const string& innerValue = (attr == 3) ? values[j] : none;
+        if (outerIsLeft) printJoined(out, attr, key, batch[i].second, innerValue);
+        else printJoined(out, attr, key, innerValue, batch[i].second);
+        count++;
+      }
+    }
+  }
+  batch.clear();
+  return 0;
+}
+
+// index nested-loop join: the outer table is read in batches of
+// JOIN_BATCH_SIZE tuples, which are looked up in the BTreeIndex of the
+// inner table
+static RC indexJoin(const RecordFile& outer, const RecordFile& inner, BTreeIndex& index,
+                    bool outerIsLeft, int attr, ResultSink& out, int& count)
+{
+  RC rc = 0;
+  RecordBlock* block = new RecordBlock;
+  RecordBlock* innerBlock = new RecordBlock;
+  vector<pair<int, string> > batch;
+  PageId pages = pageCount(outer);
+
+  for (PageId pid = 0; pid < pages && rc == 0; pid += RecordBlock::MAX_PAGES) {
+    if ((rc = outer.readBlock(pid, RecordBlock::MAX_PAGES, *block)) < 0) break;
+    for (int i = 0; i < block->count; i++) {
+      batch.push_back(make_pair(block->keys[i], attr == 3 ? string(block->values[i]) : string()));
+    }
+    if (batch.size() >= JOIN_BATCH_SIZE || pid + RecordBlock::MAX_PAGES >= pages) {
+      rc = probeBatch(batch, inner, index, outerIsLeft, attr, out, *innerBlock, count);
+    }
+  }
+
+  delete block;
+  delete innerBlock;
+  return rc;
+}
+
+// join a build table that fits in memory with a probe table: the build
+// tuples are put in a hash table with chaining, and each probe tuple is
+// looked up in it
+static RC hashJoinPart(const RecordFile& build, const RecordFile& probe, bool buildIsLeft,
+                       int attr, ResultSink& out, RecordBlock& block, int& count)
+{
+  RC rc;
+  vector<int>    keys;
+  vector<string> values;
+  vector<int>    chain;  // the next build tuple in the same bucket
+  vector<int>    heads;  // the first build tuple of each bucket
+  PageId pages = pageCount(build);
+  string none;
+
+  for (PageId pid = 0; pid < pages; pid += RecordBlock::MAX_PAGES) {
+    if ((rc = build.readBlock(pid, RecordBlock::MAX_PAGES, block)) < 0) return rc;
+    for (int i = 0; i < block.count; i++) {
+      keys.push_back(block.keys[i]);
+      if (attr == 3) values.push_back(block.values[i]);
+    }
+  }
+  if (keys.empty()) return 0;
+
+  unsigned mask = 1;
+  while (mask < keys.size() * 2) mask <<= 1;
+  mask--;
+  heads.assign(mask + 1, -1);
+  chain.resize(keys.size());
+  for (unsigned i = 0; i < keys.size(); i++) {
+    unsigned b = (hashKey(keys[i]) >> 8) & mask;
+    chain[i] = heads[b];
+    heads[b] = i;
+  }
+
+  pages = pageCount(probe);
+  for (PageId pid = 0; pid < pages; pid += RecordBlock::MAX_PAGES) {
+    if ((rc = probe.readBlock(pid, RecordBlock::MAX_PAGES, block)) < 0) return rc;
+    for (int i = 0; i < block.count; i++) {
+      int key = block.keys[i];
+      for (int j = heads[(hashKey(key) >> 8) & mask]; j >= 0; j = chain[j]) {
+        if (keys[j] != key) continue;
+        count++;
+        if (attr == 4) continue;
+        const string& buildValue = (attr == 3) ? values[j] : none;
+        string probeValue = (attr == 3) ? block.values[i] : "";
+        if (buildIsLeft) printJoined(out, attr, key, buildValue, probeValue);
+        else printJoined(out, attr, key, probeValue, buildValue);
+      }
+    }
+  }
+  return 0;
+}
+
+// write the tuples of a table to the partitions of a hash join, by the
+// hash of their keys. the values are dropped unless they are printed
+static RC partitionTable(const RecordFile& rf, vector<RecordFile*>& parts, int attr,
+                         RecordBlock& block)
+{
+  RC       rc;
+  RecordId rid;
+  PageId   pages = pageCount(rf);
+  string   none;
+
+  for (PageId pid = 0; pid < pages; pid += RecordBlock::MAX_PAGES) {
+    if ((rc = rf.readBlock(pid, RecordBlock::MAX_PAGES, block)) < 0) return rc;
+    for (int i = 0; i < block.count; i++) {
+      RecordFile* part = parts[hashKey(block.keys[i]) % parts.size()];
+      if ((rc = part->append(block.keys[i], attr == 3 ? block.values[i] : none, rid)) < 0) return rc;
+    }
+  }
+  return 0;
+}
+
+// partitioned hash join: the smaller table is the build table. if it has
+// more than JOIN_MEMORY_ROWS tuples, both tables are first split into
+// partitions small enough to build in memory, in temporary RecordFiles
+// <name>.b.N and <name>.p.N, and the partitions are joined pairwise
+static RC hashJoin(const RecordFile& build, const RecordFile& probe, bool buildIsLeft,
+                   int attr, ResultSink& out, const string& name, int& count)
+{
+  RC rc = 0;
+  RecordBlock* block = new RecordBlock;
+  vector<RecordFile*> buildParts, probeParts;
+  int  parts = build.recordCount() / JOIN_MEMORY_ROWS + 1;
+  char suffix[16];
+
+  if (parts == 1) {
+    rc = hashJoinPart(build, probe, buildIsLeft, attr, out, *block, count);
+    delete block;
+    return rc;
+  }
+
+  for (int p = 0; p < parts && rc == 0; p++) {
+    sprintf(suffix, ".%d", p);
+    buildParts.push_back(new RecordFile);
+    probeParts.push_back(new RecordFile);
+    ::unlink((name + ".b" + suffix).c_str());
+    ::unlink((name + ".p" + suffix).c_str());
+    if ((rc = buildParts[p]->open(name + ".b" + suffix, 'w')) == 0) {
+      rc = probeParts[p]->open(name + ".p" + suffix, 'w');
+    }
+  }
+  if (rc == 0) rc = partitionTable(build, buildParts, attr, *block);
+  if (rc == 0) rc = partitionTable(probe, probeParts, attr, *block);
+  for (int p = 0; p < parts && rc == 0; p++) {
+    rc = hashJoinPart(*buildParts[p], *probeParts[p], buildIsLeft, attr, out, *block, count);
+  }
+
+  for (unsigned p = 0; p < buildParts.size(); p++) {
+    sprintf(suffix, ".%d", p);
+    buildParts[p]->close();
+    probeParts[p]->close();
+    ::unlink((name + ".b" + suffix).c_str());
+    ::unlink((name + ".p" + suffix).c_str());
+    delete buildParts[p];
+    delete probeParts[p];
+  }
+  delete block;
+  return rc;
+}
+
+RC SqlEngine::join(int attr, const string& left, const string& right)
+{
+  RecordFile* leftRf = NULL;   // RecordFiles containing the tables,
+  RecordFile* rightRf = NULL;  // kept open by the Catalog
+  BTreeIndex* leftIdx = NULL;
+  BTreeIndex* rightIdx = NULL;
+  bool leftIndexed, rightIndexed;
+  ResultSink out(outputFile != NULL ? outputFile : stdout,
+                 outputFormat == BINARY_OUTPUT, attr);
+  int  count = 0;
+  char buf[128];
+  RC   rc;
+
+  if ((rc = Catalog::getTable(left, leftRf)) < 0) {
+    fprintf(stderr, "Error: table %s does not exist\n", left.c_str());
+    out.finish();
+    return rc;
+  }
+  if ((rc = Catalog::getTable(right, rightRf)) < 0) {
+    fprintf(stderr, "Error: table %s does not exist\n", right.c_str());
+    out.finish();
+    return rc;
+  }
+  leftIndexed = (Catalog::getIndex(left, leftIdx) == 0);
+  rightIndexed = (Catalog::getIndex(right, rightIdx) == 0);
+
+  // the smaller table is the outer table of an index nested-loop join,
+  // or the build table of a hash join
+  {
+    bool leftSmaller = (leftRf->recordCount() <= rightRf->recordCount());
+    const RecordFile& small = leftSmaller ? *leftRf : *rightRf;
+    const RecordFile& large = leftSmaller ? *rightRf : *leftRf;
+    bool largeIndexed = leftSmaller ? rightIndexed : leftIndexed;
+
+    // a hash join reads both tables once. an index nested-loop join
+    // reads the outer table, and about a leaf node per probe (less for
+    // sorted probes that share a leaf node) and, for "SELECT *", an inner
+    // table page per match
+    double hashCost = pageCount(*leftRf) + pageCount(*rightRf);
+    if (small.recordCount() > JOIN_MEMORY_ROWS) hashCost *= 3;
+    double probes = small.recordCount();
+    double leaves = large.recordCount() / (double) (PageFile::PAGE_SIZE / (sizeof(int) + sizeof(RecordId)));
+    double indexCost = pageCount(small) + min(probes, leaves + 1);
+    if (attr == 3) indexCost += probes;
+
+    if (largeIndexed && indexCost < hashCost) {
+      sprintf(buf, "index nested-loop join, %s probes the index of %s",
+              (leftSmaller ? left : right).c_str(), (leftSmaller ? right : left).c_str());
+      plan = buf;
+      rc = indexJoin(small, large, leftSmaller ? *rightIdx : *leftIdx, leftSmaller,
+                     attr, out, count);
+    } else {
+      int parts = small.recordCount() / JOIN_MEMORY_ROWS + 1;
+      sprintf(buf, "hash join, %s is the build table", (leftSmaller ? left : right).c_str());
+      plan = buf;
+      if (parts > 1) {
+        sprintf(buf, ", %d partitions", parts);
+        plan += buf;
+      }
+      rc = hashJoin(small, large, leftSmaller, attr, out, left + ".join", count);
+    }
+  }
+  if (rc < 0) {
+    fprintf(stderr, "Error: while joining tables %s and %s\n", left.c_str(), right.c_str());
+  } else if (attr == 4) {
+    printCount(out, count);
+  }
+
+  out.finish();
+  return rc;
+}
+
+// a statement saved by SqlEngine::prepare(). the values of the
+// conditions are owned by the statement, and NULL for a parameter
+struct PreparedSelect {
+  int    attr;
+  string table;
+  vector<vector<SelCond> > disjuncts;
+  int    order;
+  int    limit;
+  unsigned params;  // # parameters
+
+  // a copy of the conditions that SqlEngine::execute() binds the
+  // parameters in, and the value of each parameter in it, in order
+  vector<vector<SelCond> > bound;
+  vector<char**> slots;
+};
+
+static map<string, PreparedSelect> prepared;  // the saved statements by name
+
+// free the values of the conditions of a saved statement
+static void freePrepared(PreparedSelect& stmt)
+{
+  for (unsigned d = 0; d < stmt.disjuncts.size(); d++) {
+    for (unsigned i = 0; i < stmt.disjuncts[d].size(); i++) {
+      SelCond& c = stmt.disjuncts[d][i];
+      free(c.value);
+      for (unsigned j = 0; j < c.values.size(); j++) free(c.values[j]);
+    }
+  }
+}
+
+// copy a value of a condition. a parameter is counted, and stays NULL
+static char* copyValue(const char* value, unsigned& params)
+{
+  if (value != NULL) return strdup(value);
+  params++;
+  return NULL;
+}
+
+RC SqlEngine::prepare(const string& name, int attr, const string& table,
+                      const vector<vector<SelCond> >& disjuncts, int order, int limit)
+{
+  PreparedSelect stmt;
+  char buf[64];
+
+  stmt.attr = attr;
+  stmt.table = table;
+  stmt.disjuncts = disjuncts;
+  stmt.order = order;
+  stmt.limit = limit;
+  stmt.params = 0;
+  for (unsigned d = 0; d < stmt.disjuncts.size(); d++) {
+    for (unsigned i = 0; i < stmt.disjuncts[d].size(); i++) {
+      SelCond& c = stmt.disjuncts[d][i];
+      if (c.comp != SelCond::IN) c.value = copyValue(c.value, stmt.params);
+      for (unsigned j = 0; j < c.values.size(); j++) {
+        c.values[j] = copyValue(c.values[j], stmt.params);
+      }
+    }
+  }
+
+  map<string, PreparedSelect>::iterator it = prepared.find(name);
+  if (it != prepared.end()) {
+    freePrepared(it->second);
+    prepared.erase(it);
+  }
+  prepared[name] = stmt;
+
+  // the parameters are found once. the conditions stay where they are
+  // in the map, so execute() binds them in place
+  PreparedSelect& saved = prepared[name];
+  saved.bound = saved.disjuncts;
+  for (unsigned d = 0; d < saved.bound.size(); d++) {
+    for (unsigned i = 0; i < saved.bound[d].size(); i++) {
+      SelCond& c = saved.bound[d][i];
+      if (c.comp != SelCond::IN && c.value == NULL) saved.slots.push_back(&c.value);
+      for (unsigned j = 0; j < c.values.size(); j++) {
+        if (c.values[j] == NULL) saved.slots.push_back(&c.values[j]);
+      }
+    }
+  }
+
+  sprintf(buf, "statement prepared with %u parameters", stmt.params);
+  plan = buf;
+  return 0;
+}
+
+RC SqlEngine::execute(const string& name, const vector<char*>& args)
+{
+  map<string, PreparedSelect>::iterator it = prepared.find(name);
+  RC rc;
+
+  if (it == prepared.end()) {
+    fprintf(stderr, "Error: no statement %s has been prepared\n", name.c_str());
+    return RC_INVALID_ATTRIBUTE;
+  }
+  PreparedSelect& stmt = it->second;
+  if (args.size() != stmt.params) {
+    fprintf(stderr, "Error: statement %s takes %u parameters, not %u\n",
+            name.c_str(), stmt.params, (unsigned) args.size());
+    return RC_INVALID_ATTRIBUTE;
+  }
+
+  // bind the parameters in order. the values are not copied, and are
+  // unbound after the select, since the caller frees them
+  for (unsigned p = 0; p < stmt.slots.size(); p++) *stmt.slots[p] = args[p];
+  rc = select(stmt.attr, stmt.table, stmt.bound, stmt.order, stmt.limit);
+  for (unsigned p = 0; p < stmt.slots.size(); p++) *stmt.slots[p] = NULL;
+  return rc;
+}
+
+RC SqlEngine::parseLoadLine(const string& line, int& key, string& value)
+{
+    const char *s;
+    char        c;
+    string::size_type loc;
+    
+    // ignore beginning white spaces
+    c = *(s = line.c_str());
+    while (c == ' ' || c == '\t') { c = *++s; }
+
+    // get the integer key value
+    key = atoi(s);
+
+    // look for comma
+    s = strchr(s, ',');
+    if (s == NULL) { return RC_INVALID_FILE_FORMAT; }
+
+    // ignore white spaces
+    do { c = *++s; } while (c == ' ' || c == '\t');
+    
+    // if there is nothing left, set the value to empty string
+    if (c == 0) { 
+        value.erase();
+        return 0;
+    }
+
+    // is the value field delimited by ' or "?
+    if (c == '\'' || c == '"') {
+        s++;
+    } else {
+        c = '\n';
+    }
+
+    // get the value string
+    value.assign(s);
+    loc = value.find(c, 0);
+    if (loc != string::npos) { value.erase(loc); }
+
+    return 0;
+}
@@ -1,72 +1,214 @@
-/*
- * Copyright (C) 2008 by The Regents of the University of California
- * Redistribution of this file is permitted under the terms of the GNU
- * Public License (GPL).
- *
- * @author Junghoo "John" Cho <cho AT cs.ucla.edu>
- * @date 3/24/2008
- */
-
-#ifndef SQLENGINE_H
-#define SQLENGINE_H
-
-#include <vector>
-#include "Bruinbase.h"
-#include "RecordFile.h"
-
-/**
- * data structure to represent a condition in the WHERE clause
- */
-struct SelCond {
-  int attr;     // attribute: 1 - key column,  2 - value column
-  enum Comparator { EQ, NE, LT, GT, LE, GE } comp;
-  char* value;  // the value to compare
-};
-
-/**
- * the class that takes, parses, and executes the user commands.
- */
-class SqlEngine {
- public:
-    
-  /**
-   * takes the user commands from commandline and executes them.
-   * when user issues SELECT or LOAD from commandline, this function
-   * calls SqlEngine::select() or SqlEngine::load() functions.
-   * @param commandline[IN] the input stream to get user commands
-   * @return error code. 0 if no error
-   */
-  static RC run(FILE* commandline);
-
-  /**
-   * executes a SELECT statement.
-   * all conditions in conds must be ANDed together.
-   * the result of the SELECT is printed on screen.
-   * @param attr[IN] attribute in the SELECT clause
-   * (1: key, 2: value, 3: *, 4: count(*))
-   * @param table[IN] the table name in the FROM clause
-   * @param conds[IN] list of conditions in the WHERE clause
-   * @return error code. 0 if no error
-   */
-  static RC select(int attr, const std::string& table, const std::vector<SelCond>& conds);
-
-  /**
-   * load a table from a load file.
-   * @param table[IN] the table name in the LOAD command
-   * @param loadfile[IN] the file name of the load file
-   * @param index[IN] true if "WITH INDEX" option was specified
-   * @return error code. 0 if no error
-   */
-  static RC load(const std::string& table, const std::string& loadfile, bool index);
-
-  /**
-   * parse a line from the load file into the (key, value) pair.
-   * @param line[IN] a line from a load file
-   * @param key[OUT] the key field of the tuple in the line
-   * @param value[OUT] the value field of the tuple in the line
-   * @return error code. 0 if no error
-   */
-  static RC parseLoadLine(const std::string& line, int& key, std::string& value);
-};
-
-#endif /* SQLENGINE_H */
+/*
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ *
+ * @author Junghoo "John" Cho <cho AT cs.ucla.edu>
+ * @date 3/24/2008
+ */
+
+#ifndef SQLENGINE_H
+#define SQLENGINE_H
+
+#include <vector>
+#include "Bruinbase.h"
+#include "RecordFile.h"
+
+/**
+ * data structure to represent a condition in the WHERE clause
+ */
+struct SelCond {
+  int attr;     // attribute: 1 - key column,  2 - value column
+  enum Comparator { EQ, NE, LT, GT, LE, GE, IN } comp;
+  char* value;  // the value to compare
+  std::vector<char*> values;  // the list of values to compare for IN
+};
+
+/**
+ * the class that takes, parses, and executes the user commands.
+ */
+class SqlEngine {
+ public:
+
+  /**
+   * the kind of index built by load()
+   */
+  enum IndexType {
+    NO_INDEX,     // no index
+    BTREE_INDEX,  // "WITH INDEX": BTreeIndex in <table>.idx
+    LSM_INDEX,    // "WITH LSM INDEX": LSMTree in <table>.lsm, for append-heavy tables
+    HASH_INDEX,   // "WITH HASH INDEX": BTreeIndex plus HashIndex in <table>.hidx
+                  //   for key equality lookups
+    LEARNED_INDEX // "WITH LEARNED INDEX": BTreeIndex plus a learned model of
+                  //   its leaf level, for tables that are only queried after load
+  };
+
+  /**
+   * the order of the tuples printed by select()
+   */
+  enum SortOrder {
+    UNORDERED,        // the order the tuples are found in
+    ASCENDING,        // "ORDER BY key" or "ORDER BY key ASC"
+    DESCENDING,       // "ORDER BY key DESC"
+    VALUE_ASCENDING,  // "ORDER BY value" or "ORDER BY value ASC"
+    VALUE_DESCENDING  // "ORDER BY value DESC"
+  };
+
+  /**
+   * the format of the tuples printed by select()
+   */
+  enum OutputFormat {
+    TEXT_OUTPUT,   // "OUTPUT TEXT": a line per tuple (the default)
+    BINARY_OUTPUT  // "OUTPUT BINARY": batches of columns (see ResultSink)
+  };
+    
+  /**
+   * takes the user commands from commandline and executes them.
+   * when user issues SELECT or LOAD from commandline, this function
+   * calls SqlEngine::select() or SqlEngine::load() functions.
+   * @param commandline[IN] the input stream to get user commands
+   * @return error code. 0 if no error
+   */
+  static RC run(FILE* commandline);
+
+  /**
+   * executes a SELECT statement.
+   * all conditions in conds must be ANDed together.
+   * the result of the SELECT is printed on screen.
+   * @param attr[IN] attribute in the SELECT clause
+   * (1: key, 2: value, 3: *, 4: count(*), 5: min(key), 6: max(key),
+   *  7: sum(key), 8: avg(key), 9: value, count(*) ... group by value).
+   * min(key) and max(key) read the first matching index entry from
+   * either end of the key range, and sum(key) and avg(key) read the keys
+   * from the index only. without conditions, count(*) follows from the
+   * end of the table file, and min(key) and max(key) are read from the
+   * header page of the BTreeIndex. the groups of 9 are counted by a
+   * HashAggregate, and order and limit apply to the groups
+   * @param table[IN] the table name in the FROM clause
+   * @param conds[IN] list of conditions in the WHERE clause
+   * @param order[IN] the order of the printed tuples (see SortOrder).
+   *                  DESCENDING walks the index from the right. the
+   *                  tuples are sorted (see RowSorter) unless an index
+   *                  scan finds them in order
+   * @param limit[IN] # tuples to print at most ("LIMIT n"), or -1 for all.
+   *                  a scan that finds the tuples in order stops early
+   * @return error code. 0 if no error
+   */
+  static RC select(int attr, const std::string& table, const std::vector<SelCond>& conds,
+                   int order, int limit);
+
+  /**
+   * executes a SELECT statement whose WHERE clause is a disjunction:
+   * a tuple is selected if it meets all conditions of any of the
+   * disjuncts. if every disjunct narrows the key range, each range is
+   * read from the BTreeIndex and the RecordIds are merged, so that a
+   * tuple is printed once. otherwise the table is scanned once.
+   * @param attr[IN] attribute in the SELECT clause (see above)
+   * @param table[IN] the table name in the FROM clause
+   * @param disjuncts[IN] the conditions of each disjunct, ANDed together
+   * @param order[IN] the order of the printed tuples (see SortOrder)
+   * @param limit[IN] # tuples to print at most, or -1 for all
+   * @return error code. 0 if no error
+   */
+  static RC select(int attr, const std::string& table,
+                   const std::vector<std::vector<SelCond> >& disjuncts, int order, int limit);
+
+  /**
+   * executes "SELECT ... FROM left, right WHERE left.key = right.key".
+   * the tuples are joined by an index nested-loop join, which looks up
+   * the sorted keys of the smaller table in the BTreeIndex of the larger
+   * one, or by a hash join, which builds a hash table of the smaller
+   * table, partitioned on disk if it does not fit in memory. the join
+   * that reads fewer pages is chosen from the sizes of the tables.
+   * @param attr[IN] attribute in the SELECT clause (1: key, 3: *, 4: count(*)).
+   *                 * prints the key, then the values of left and right
+   * @param left[IN] the first table name in the FROM clause
+   * @param right[IN] the second table name in the FROM clause
+   * @return error code. 0 if no error
+   */
+  static RC join(int attr, const std::string& left, const std::string& right);
+
+  /**
+   * save a SELECT statement under a name ("PREPARE name AS SELECT ..."),
+   * to run it any number of times with execute() without parsing it
+   * again. a NULL value in the conditions ('?' in the statement) is a
+   * parameter, bound to an argument of execute(). a statement saved
+   * earlier under the same name is replaced.
+   * @param name[IN] the name of the statement
+   * @param attr[IN] attribute in the SELECT clause (see select())
+   * @param table[IN] the table name in the FROM clause
+   * @param disjuncts[IN] the conditions of each disjunct, ANDed together.
+   *                      the values are copied
+   * @param order[IN] the order of the printed tuples (see SortOrder)
+   * @param limit[IN] # tuples to print at most, or -1 for all
+   * @return error code. 0 if no error
+   */
+  static RC prepare(const std::string& name, int attr, const std::string& table,
+                    const std::vector<std::vector<SelCond> >& disjuncts, int order, int limit);
+
+  /**
+   * run a statement saved by prepare() ("EXECUTE name(arg, ...)").
+   * @param name[IN] the name of the statement
+   * @param args[IN] the values of the parameters, in the order of the
+   *                 '?'s in the statement
+   * @return error code. 0 if no error
+   */
+  static RC execute(const std::string& name, const std::vector<char*>& args);
+
+  /**
+   * load a table from a load file.
+   * @param table[IN] the table name in the LOAD command
+   * @param loadfile[IN] the file name of the load file
+   * @param index[IN] the kind of index to build (see IndexType).
+   *                  an existing index of the table is extended.
+   * @return error code. 0 if no error
+   */
+  static RC load(const std::string& table, const std::string& loadfile, int index);
+
+  /**
+   * rewrite a table in key order, so that an index range scan reads the
+   * table pages sequentially. the table is sorted with an external merge
+   * sort, and its BTreeIndex and HashIndex are rebuilt for the new
+   * RecordIds. a table with an LSM index cannot be clustered.
+   * @param table[IN] the table name in the CLUSTER command
+   * @return error code. 0 if no error
+   */
+  static RC cluster(const std::string& table);
+
+  /**
+   * collect the statistics of a table (see TableStats) and save them in
+   * <table>.stat. select() uses them to choose between a heap scan and
+   * an index scan. load() and cluster() drop the statistics.
+   * @param table[IN] the table name in the ANALYZE command
+   * @return error code. 0 if no error
+   */
+  static RC analyze(const std::string& table);
+
+  /**
+   * set the format and the destination of the output of the following
+   * select() calls in this session.
+   * @param format[IN] the output format (see OutputFormat)
+   * @param filename[IN] the file to append the output to. the output goes
+   *                     to stdout if filename is empty
+   * @return error code. 0 if no error
+   */
+  static RC setOutput(int format, const std::string& filename);
+
+  /**
+   * describe how the last select() read the table, e.g.
+   * "index-only scan, estimated 120 of 20000 tuples"
+   * @return the plan of the last select()
+   */
+  static const char* getPlan();
+
+  /**
+   * parse a line from the load file into the (key, value) pair.
+   * @param line[IN] a line from a load file
+   * @param key[OUT] the key field of the tuple in the line
+   * @param value[OUT] the value field of the tuple in the line
+   * @return error code. 0 if no error
+   */
+  static RC parseLoadLine(const std::string& line, int& key, std::string& value);
+};
+
+#endif /* SQLENGINE_H */
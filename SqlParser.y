@@ -1,151 +1,451 @@
-%{
-#include <cstdio>
-#include <cstring>
-#include <sys/times.h>
-#include <unistd.h>
-#include <climits>
-#include <string>
-#include "Bruinbase.h"
-#include "SqlEngine.h" 
-#include "PageFile.h"
-
-int  sqllex(void);  
-void sqlerror(const char *str) { fprintf(stderr, "Error: %s\n", str); }
-extern "C" { int  sqlwrap() { return 1; } }
-
-static void runSelect(int attr, const char* table, const std::vector<SelCond>& conds)
-{
-  struct tms tmsbuf;
-  clock_t btime, etime;
-  int     bpagecnt, epagecnt;
-
-  btime = times(&tmsbuf);
-  bpagecnt = PageFile::getPageReadCount();
-  SqlEngine::select(attr, table, conds);
-  etime = times(&tmsbuf);
-  epagecnt = PageFile::getPageReadCount();
-
-  fprintf(stderr, "  -- %.3f seconds to run the select command. Read %d pages\n", ((float)(etime - btime))/sysconf(_SC_CLK_TCK), epagecnt - bpagecnt);
-}
-
-%}
-
-%union {
-  int integer;
-  char* string;
-  SelCond* cond;
-  std::vector<SelCond>* conds;
-}
-
-%token SELECT FROM WHERE LOAD WITH INDEX QUIT COUNT AND OR 
-%token COMMA STAR LF
-%token <string> INTEGER STRING ID
-%token EQUAL NEQUAL LESS LESSEQUAL GREATER GREATEREQUAL 
-
-%type <integer> attributes attribute comparator
-%type <string> table value
-%type <cond> condition
-%type <conds> conditions
-%%
-
-commands:
-	commands command
-	|
-	;
-
-command:
-        load_command { fprintf(stdout, "Bruinbase> "); }
-	| select_command { fprintf(stdout, "Bruinbase> "); }
-	| quit_command
-	| error LF { fprintf(stdout, "Bruinbase> "); }
-	| LF { fprintf(stdout, "Bruinbase> "); }
-	;
-
-quit_command:
-	QUIT { return 0; }
-	;
-
-load_command:
-	LOAD table FROM STRING LF { 
-	  SqlEngine::load(std::string($2), std::string($4), false); 
-	  free($2);
-	  free($4);
-	}
-	| LOAD table FROM STRING WITH INDEX LF { 
-	  SqlEngine::load(std::string($2), std::string($4), true); 
-	  free($2);
-	  free($4);
-	}
-	;
-
-select_command:
-	SELECT attributes FROM table LF {
-   	        std::vector<SelCond> conds;
-		runSelect($2, $4, conds);
-		free($4);
-	}
-	| SELECT attributes FROM table WHERE conditions LF {
-	        runSelect($2, $4, *$6);
-	  	free($4);
-	  	for (unsigned i = 0; i < $6->size(); i++) {
-		    free((*$6)[i].value);
-		}
-	  	delete $6;
-	}
-	;
-
-conditions:
-	condition {
-	  std::vector<SelCond>* v = new std::vector<SelCond>;
-	  v->push_back(*$1);
-	  $$ = v;
-          delete $1;
-	}
-	| conditions AND condition {
-	  $1->push_back(*$3);
-	  $$ = $1;
-          delete $3;
-	}
-	;
-
-condition:
-	attribute comparator value { 
-	  SelCond* c = new SelCond;
-	  c->attr = $1;
-	  c->comp = static_cast<SelCond::Comparator>($2);
-	  c->value = $3;
-	  $$ = c;
-        }
-	;
-
-attributes:
-	attribute { $$ = $1; }
-	| STAR  { $$ = 3; }
-	| COUNT { $$ = 4; }
-	;
-
-attribute:
-	ID { 
-		if (strcasecmp($1, "key") == 0) $$=1;
-		else if (strcasecmp($1, "value") == 0) $$=2;
-		else sqlerror("wrong attribute name. neither key or value");
-		free($1);
-	}
-
-value:
-	INTEGER  { $$ = $1; }
-        | STRING { $$ = $1; }
-	;
-
-table:
-	ID { $$ = $1; }
-	;
-
-comparator:
-	EQUAL          { $$ = SelCond::EQ; }
-	| NEQUAL       { $$ = SelCond::NE; }
-	| LESS         { $$ = SelCond::LT; }
-	| GREATER      { $$ = SelCond::GT; }
-	| LESSEQUAL    { $$ = SelCond::LE; }
-	| GREATEREQUAL { $$ = SelCond::GE; }
-	;
+%{
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <sys/times.h>
+#include <unistd.h>
+#include <climits>
+#include <string>
+#include "Bruinbase.h"
+#include "SqlEngine.h" 
+#include "PageFile.h"
+
+int  sqllex(void);  
+void sqlerror(const char *str) { fprintf(stderr, "Error: %s\n", str); }
+extern "C" { int  sqlwrap() { return 1; } }
+
+static void runSelect(int attr, const char* table, const std::vector<std::vector<SelCond> >& conds, int order, int limit)
+{
+  struct tms tmsbuf;
+  clock_t btime, etime;
+  int     bpagecnt, epagecnt;
+
+  btime = times(&tmsbuf);
+  bpagecnt = PageFile::getPageReadCount();
+  SqlEngine::select(attr, table, conds, order, limit);
+  etime = times(&tmsbuf);
+  epagecnt = PageFile::getPageReadCount();
+
+  fprintf(stderr, "  -- plan: %s\n", SqlEngine::getPlan());
+  fprintf(stderr, "  -- %.3f seconds to run the select command. Read %d pages\n", ((float)(etime - btime))/sysconf(_SC_CLK_TCK), epagecnt - bpagecnt);
+}
+
+// "SELECT ... FROM left, right WHERE left.key = right.key". the column
+// names must name the two tables and their keys
+static void runJoin(int attr, const char* left, const char* right,
+                    const char* table1, int attr1, const char* table2, int attr2)
+{
+  struct tms tmsbuf;
+  clock_t btime, etime;
+  int     bpagecnt, epagecnt;
+
+  if (attr != 1 && attr != 3 && attr != 4) {
+    sqlerror("only SELECT key, * or COUNT(*) is supported on a join");
+    return;
+  }
+  if (attr1 != 1 || attr2 != 1) {
+    sqlerror("only tables joined on their keys are supported");
+    return;
+  }
+  if ((strcmp(table1, table2) == 0 && strcmp(left, right) != 0) ||
+      (strcmp(table1, left) != 0 && strcmp(table1, right) != 0) ||
+      (strcmp(table2, left) != 0 && strcmp(table2, right) != 0)) {
+    sqlerror("the join condition must compare the keys of both tables");
+    return;
+  }
+
+  btime = times(&tmsbuf);
+  bpagecnt = PageFile::getPageReadCount();
+  SqlEngine::join(attr, left, right);
+  etime = times(&tmsbuf);
+  epagecnt = PageFile::getPageReadCount();
+
+  fprintf(stderr, "  -- plan: %s\n", SqlEngine::getPlan());
+  fprintf(stderr, "  -- %.3f seconds to run the select command. Read %d pages\n", ((float)(etime - btime))/sysconf(_SC_CLK_TCK), epagecnt - bpagecnt);
+}
+
+// run a prepared statement with the values of its parameters
+static void runExecute(const char* name, const std::vector<char*>& params)
+{
+  struct tms tmsbuf;
+  clock_t btime, etime;
+  int     bpagecnt, epagecnt;
+
+  btime = times(&tmsbuf);
+  bpagecnt = PageFile::getPageReadCount();
+  if (SqlEngine::execute(name, params) < 0) return;
+  etime = times(&tmsbuf);
+  epagecnt = PageFile::getPageReadCount();
+
+  fprintf(stderr, "  -- plan: %s\n", SqlEngine::getPlan());
+  fprintf(stderr, "  -- %.3f seconds to run the select command. Read %d pages\n", ((float)(etime - btime))/sysconf(_SC_CLK_TCK), epagecnt - bpagecnt);
+}
+
+// a '?' parameter (a NULL value) is only allowed in PREPARE
+static bool hasParams(const std::vector<std::vector<SelCond> >& conds)
+{
+  for (unsigned d = 0; d < conds.size(); d++) {
+    for (unsigned i = 0; i < conds[d].size(); i++) {
+      const SelCond& c = conds[d][i];
+      if (c.comp != SelCond::IN && c.value == NULL) return true;
+      for (unsigned j = 0; j < c.values.size(); j++) {
+        if (c.values[j] == NULL) return true;
+      }
+    }
+  }
+  return false;
+}
+
+// free the values of the conditions of a WHERE clause
+static void freeConds(std::vector<std::vector<SelCond> >* conds)
+{
+  for (unsigned d = 0; d < conds->size(); d++) {
+    std::vector<SelCond>& c = (*conds)[d];
+    for (unsigned i = 0; i < c.size(); i++) {
+      free(c[i].value);
+      for (unsigned j = 0; j < c[i].values.size(); j++) {
+        free(c[i].values[j]);
+      }
+    }
+  }
+  delete conds;
+}
+
+// "SELECT value, COUNT(*)" goes with "GROUP BY value", and its groups
+// are ordered by value only
+static bool checkGroup(int attr, int group, int order)
+{
+  if ((attr == 9) != (group == 2)) {
+    sqlerror("SELECT value, COUNT(*) needs GROUP BY value, and the other way around");
+    return false;
+  }
+  if (attr == 9 && (order == SqlEngine::ASCENDING || order == SqlEngine::DESCENDING)) {
+    sqlerror("the groups of GROUP BY value can only be ordered by value");
+    return false;
+  }
+  return true;
+}
+
+%}
+
+%union {
+  int integer;
+  char* string;
+  SelCond* cond;
+  std::vector<SelCond>* conds;
+  std::vector<std::vector<SelCond> >* disjuncts;
+  std::vector<char*>* values;
+}
+
+%token SELECT FROM WHERE LOAD WITH INDEX LSM HASH LEARNED CLUSTER ANALYZE OUTPUT TEXT BINARY TO QUIT COUNT MIN MAX SUM AVG AND OR IN
+%token ORDER BY ASC DESC LIMIT GROUP PREPARE EXECUTE AS
+%token COMMA DOT QMARK STAR LF LPAREN RPAREN
+%token <string> INTEGER STRING ID
+%token EQUAL NEQUAL LESS LESSEQUAL GREATER GREATEREQUAL 
+
+%type <integer> attributes attribute comparator order limit group
+%type <string> table value
+%type <cond> condition
+%type <conds> conjunction
+%type <disjuncts> conditions
+%type <values> values
+%%
+
+commands:
+	commands command
+	|
+	;
+
+command:
+        load_command { fprintf(stdout, "Bruinbase> "); }
+	| cluster_command { fprintf(stdout, "Bruinbase> "); }
+	| analyze_command { fprintf(stdout, "Bruinbase> "); }
+	| output_command { fprintf(stdout, "Bruinbase> "); }
+	| select_command { fprintf(stdout, "Bruinbase> "); }
+	| prepare_command { fprintf(stdout, "Bruinbase> "); }
+	| execute_command { fprintf(stdout, "Bruinbase> "); }
+	| quit_command
+	| error LF { fprintf(stdout, "Bruinbase> "); }
+	| LF { fprintf(stdout, "Bruinbase> "); }
+	;
+
+quit_command:
+	QUIT { return 0; }
+	;
+
+load_command:
+	LOAD table FROM STRING LF { 
+	  SqlEngine::load(std::string($2), std::string($4), SqlEngine::NO_INDEX);
+	  free($2);
+	  free($4);
+	}
+	| LOAD table FROM STRING WITH INDEX LF { 
+	  SqlEngine::load(std::string($2), std::string($4), SqlEngine::BTREE_INDEX);
+	  free($2);
+	  free($4);
+	}
+	| LOAD table FROM STRING WITH HASH INDEX LF { 
+	  SqlEngine::load(std::string($2), std::string($4), SqlEngine::HASH_INDEX);
+	  free($2);
+	  free($4);
+	}
+	| LOAD table FROM STRING WITH LEARNED INDEX LF { 
+	  SqlEngine::load(std::string($2), std::string($4), SqlEngine::LEARNED_INDEX);
+	  free($2);
+	  free($4);
+	}
+	| LOAD table FROM STRING WITH LSM INDEX LF { 
+	  SqlEngine::load(std::string($2), std::string($4), SqlEngine::LSM_INDEX);
+	  free($2);
+	  free($4);
+	}
+	;
+
+cluster_command:
+	CLUSTER table LF {
+	  SqlEngine::cluster(std::string($2));
+	  free($2);
+	}
+	;
+
+analyze_command:
+	ANALYZE table LF {
+	  SqlEngine::analyze(std::string($2));
+	  free($2);
+	}
+	;
+
+output_command:
+	OUTPUT TEXT LF {
+	  SqlEngine::setOutput(SqlEngine::TEXT_OUTPUT, "");
+	}
+	| OUTPUT BINARY LF {
+	  SqlEngine::setOutput(SqlEngine::BINARY_OUTPUT, "");
+	}
+	| OUTPUT TEXT TO STRING LF {
+	  SqlEngine::setOutput(SqlEngine::TEXT_OUTPUT, std::string($4));
+	  free($4);
+	}
+	| OUTPUT BINARY TO STRING LF {
+	  SqlEngine::setOutput(SqlEngine::BINARY_OUTPUT, std::string($4));
+	  free($4);
+	}
+	;
+
+select_command:
+	SELECT attributes FROM table group order limit LF {
+   	        std::vector<std::vector<SelCond> > conds(1);
+		if (checkGroup($2, $5, $6)) runSelect($2, $4, conds, $6, $7);
+		free($4);
+	}
+	| SELECT attributes FROM table WHERE conditions group order limit LF {
+	        if (hasParams(*$6)) sqlerror("a ? parameter is only allowed in PREPARE");
+	        else if (checkGroup($2, $7, $8)) runSelect($2, $4, *$6, $8, $9);
+	  	free($4);
+	  	freeConds($6);
+	}
+	| SELECT attributes FROM table COMMA table WHERE table DOT attribute EQUAL table DOT attribute LF {
+	        runJoin($2, $4, $6, $8, $10, $12, $14);
+		free($4);
+		free($6);
+		free($8);
+		free($12);
+	}
+	;
+
+prepare_command:
+	PREPARE ID AS SELECT attributes FROM table group order limit LF {
+   	        std::vector<std::vector<SelCond> > conds(1);
+		if (checkGroup($5, $8, $9)) SqlEngine::prepare($2, $5, $7, conds, $9, $10);
+		free($2);
+		free($7);
+	}
+	| PREPARE ID AS SELECT attributes FROM table WHERE conditions group order limit LF {
+		if (checkGroup($5, $10, $11)) SqlEngine::prepare($2, $5, $7, *$9, $11, $12);
+		free($2);
+		free($7);
+		freeConds($9);
+	}
+	;
+
+execute_command:
+	EXECUTE ID LF {
+		runExecute($2, std::vector<char*>());
+		free($2);
+	}
+	| EXECUTE ID LPAREN values RPAREN LF {
+		bool bound = true;
+		for (unsigned i = 0; i < $4->size(); i++) {
+		  if ((*$4)[i] == NULL) bound = false;
+		}
+		if (!bound) sqlerror("the arguments of EXECUTE cannot be ?");
+		else runExecute($2, *$4);
+		free($2);
+		for (unsigned i = 0; i < $4->size(); i++) free((*$4)[i]);
+		delete $4;
+	}
+	;
+
+group:
+	/* empty */ { $$ = 0; }
+	| GROUP BY attribute {
+		if ($3 != 2) {
+			sqlerror("only GROUP BY value is supported");
+			YYERROR;
+		}
+		$$ = $3;
+	}
+	;
+
+order:
+	/* empty */ { $$ = SqlEngine::UNORDERED; }
+	| ORDER BY attribute {
+		$$ = ($3 == 1) ? SqlEngine::ASCENDING : SqlEngine::VALUE_ASCENDING;
+	}
+	| ORDER BY attribute ASC {
+		$$ = ($3 == 1) ? SqlEngine::ASCENDING : SqlEngine::VALUE_ASCENDING;
+	}
+	| ORDER BY attribute DESC {
+		$$ = ($3 == 1) ? SqlEngine::DESCENDING : SqlEngine::VALUE_DESCENDING;
+	}
+	;
+
+limit:
+	/* empty */ { $$ = -1; }
+	| LIMIT INTEGER {
+		$$ = atoi($2);
+		free($2);
+		if ($$ < 0) {
+			sqlerror("LIMIT must not be negative");
+			YYERROR;
+		}
+	}
+	;
+
+conditions:
+	conjunction {
+	  std::vector<std::vector<SelCond> >* v = new std::vector<std::vector<SelCond> >(1);
+	  (*v)[0].swap(*$1);
+	  $$ = v;
+          delete $1;
+	}
+	| conditions OR conjunction {
+	  $1->push_back(std::vector<SelCond>());
+	  $1->back().swap(*$3);
+	  $$ = $1;
+          delete $3;
+	}
+	;
+
+conjunction:
+	condition {
+	  std::vector<SelCond>* v = new std::vector<SelCond>;
+	  v->push_back(*$1);
+	  $$ = v;
+          delete $1;
+	}
+	| conjunction AND condition {
+	  $1->push_back(*$3);
+	  $$ = $1;
+          delete $3;
+	}
+	;
+
+condition:
+	attribute comparator value { 
+	  SelCond* c = new SelCond;
+	  c->attr = $1;
+	  c->comp = static_cast<SelCond::Comparator>($2);
+	  c->value = $3;
+	  $$ = c;
+        }
+	| attribute IN LPAREN values RPAREN {
+	  SelCond* c = new SelCond;
+	  c->attr = $1;
+	  c->comp = SelCond::IN;
+	  c->value = NULL;
+	  c->values = *$4;
+	  $$ = c;
+	  delete $4;
+	}
+	;
+
+values:
+	value {
+	  std::vector<char*>* v = new std::vector<char*>;
+	  v->push_back($1);
+	  $$ = v;
+	}
+	| values COMMA value {
+	  $1->push_back($3);
+	  $$ = $1;
+	}
+	;
+
+attributes:
+	attribute { $$ = $1; }
+	| STAR  { $$ = 3; }
+	| COUNT { $$ = 4; }
+	| attribute COMMA COUNT {
+		if ($1 != 2) {
+			sqlerror("only SELECT value, COUNT(*) is supported");
+			YYERROR;
+		}
+		$$ = 9;
+	}
+	| MIN LPAREN attribute RPAREN {
+		if ($3 != 1) {
+			sqlerror("only MIN(key) is supported");
+			YYERROR;
+		}
+		$$ = 5;
+	}
+	| MAX LPAREN attribute RPAREN {
+		if ($3 != 1) {
+			sqlerror("only MAX(key) is supported");
+			YYERROR;
+		}
+		$$ = 6;
+	}
+	| SUM LPAREN attribute RPAREN {
+		if ($3 != 1) {
+			sqlerror("only SUM(key) is supported");
+			YYERROR;
+		}
+		$$ = 7;
+	}
+	| AVG LPAREN attribute RPAREN {
+		if ($3 != 1) {
+			sqlerror("only AVG(key) is supported");
+			YYERROR;
+		}
+		$$ = 8;
+	}
+	;
+
+attribute:
+	ID { 
+		if (strcasecmp($1, "key") == 0) $$=1;
+		else if (strcasecmp($1, "value") == 0) $$=2;
+		else sqlerror("wrong attribute name. neither key or value");
+		free($1);
+	}
+
+value:
+	INTEGER  { $$ = $1; }
+        | STRING { $$ = $1; }
+        | QMARK  { $$ = NULL; }
+	;
+
+table:
+	ID { $$ = $1; }
+	;
+
+comparator:
+	EQUAL          { $$ = SelCond::EQ; }
+	| NEQUAL       { $$ = SelCond::NE; }
+	| LESS         { $$ = SelCond::LT; }
+	| GREATER      { $$ = SelCond::GT; }
+	| LESSEQUAL    { $$ = SelCond::LE; }
+	| GREATEREQUAL { $$ = SelCond::GE; }
+	;
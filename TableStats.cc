@@ -0,0 +1,154 @@
+#include "TableStats.h"
+#include "RecordFile.h"
+#include "BTreeIndex.h"
+#include <string.h>
+#include <climits>
+#include <algorithm>
+
+using namespace std;
+
+// The statistics file has a single page.
+// ---------------------------------------------------------------------------------------------
+// |--# tuples--|--# pages--|--# leaf nodes--|--# index scan page fetches--|--# buckets--|--bounds--|
+// ---------------------------------------------------------------------------------------------
+// All fields are 4 bytes. There are (# buckets + 1) bounds.
+
+static const int STATS_HEADER_SIZE = 5 * sizeof(int);
+
+TableStats::TableStats()
+{
+	rowCount = pageCount = leafCount = fetchCount = 0;
+}
+
+RC TableStats::compute(const string& table)
+{
+	RecordFile rf;
+	BTreeIndex bti;
+	RecordId   rid;
+	IndexCursor ic;
+	vector<int> keys;
+	int        key;
+	string     value;
+	RC         rc;
+
+	if ((rc = rf.open(table + ".tbl", 'r')) < 0) return rc;
+
+	// collect the keys of the table
+	for (rid.pid = rid.sid = 0; rid < rf.endRid(); ++rid) {
+		if ((rc = rf.read(rid, key, value)) < 0) {
+			rf.close();
+			return rc;
+		}
+		keys.push_back(key);
+	}
+	rowCount = keys.size();
+	pageCount = rf.endRid().pid + (rf.endRid().sid > 0 ? 1 : 0);
+	rf.close();
+
+	// bucket i starts at the key ranked i * rowCount / HISTOGRAM_BUCKETS
+	bounds.clear();
+	if (rowCount > 0) {
+		sort(keys.begin(), keys.end());
+		for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+			bounds.push_back(keys[(long long)i * rowCount / HISTOGRAM_BUCKETS]);
+		}
+		bounds.push_back(keys[rowCount - 1]);
+	}
+
+	// walk the leaf level of the BTreeIndex, counting the leaf nodes
+	// and the moves to another table page
+	leafCount = fetchCount = 0;
+	if (bti.open(table + ".idx", 'r') == 0) {
+		PageId leafPid = -1, tablePid = -1;
+		bti.locate(INT_MIN, ic);
+		for (;;) {
+			PageId pid = ic.pid;
+			if (bti.readForward(ic, key, rid) != 0) break;
+			if (pid != leafPid) { leafPid = pid; leafCount++; }
+			if (rid.pid != tablePid) { tablePid = rid.pid; fetchCount++; }
+		}
+		bti.close();
+	}
+
+	return 0;
+}
+
+RC TableStats::read(const string& table)
+{
+	PageFile pf;
+	char     page[PageFile::PAGE_SIZE];
+	int      header[5];
+	RC       rc;
+
+	if ((rc = pf.open(table + ".stat", 'r')) < 0) return rc;
+	if ((rc = pf.read(0, page)) < 0) {
+		pf.close();
+		return rc;
+	}
+	pf.close();
+
+	memcpy(header, page, STATS_HEADER_SIZE);
+	if (header[4] < 0 || STATS_HEADER_SIZE + (header[4] + 1) * (int) sizeof(int) > PageFile::PAGE_SIZE) {
+		return RC_INVALID_FILE_FORMAT;
+	}
+	rowCount = header[0];
+	pageCount = header[1];
+	leafCount = header[2];
+	fetchCount = header[3];
+	bounds.resize(header[4] > 0 ? header[4] + 1 : 0);
+	if (!bounds.empty()) {
+		memcpy(&bounds[0], page + STATS_HEADER_SIZE, bounds.size() * sizeof(int));
+	}
+
+	return 0;
+}
+
+RC TableStats::write(const string& table)
+{
+	PageFile pf;
+	char     page[PageFile::PAGE_SIZE];
+	int      header[5];
+	RC       rc;
+
+	header[0] = rowCount;
+	header[1] = pageCount;
+	header[2] = leafCount;
+	header[3] = fetchCount;
+	header[4] = bounds.empty() ? 0 : bounds.size() - 1;
+
+	memset(page, 0, PageFile::PAGE_SIZE);
+	memcpy(page, header, STATS_HEADER_SIZE);
+	if (!bounds.empty()) {
+		memcpy(page + STATS_HEADER_SIZE, &bounds[0], bounds.size() * sizeof(int));
+	}
+
+	if ((rc = pf.open(table + ".stat", 'w')) < 0) return rc;
+	rc = pf.write(0, page);
+	pf.close();
+
+	return rc;
+}
+
+// the fraction of the tuples with a key smaller than the given key,
+// assuming the keys are spread evenly within a bucket
+double TableStats::fractionBelow(double key) const
+{
+	int buckets = bounds.size() - 1;
+
+	if (key <= bounds[0]) return 0;
+	if (key > bounds[buckets]) return 1;
+
+	// find the last bucket starting below key. as bounds[i] < key <= bounds[i+1],
+	// the bucket is not empty
+	int i = lower_bound(bounds.begin(), bounds.end(), key) - bounds.begin() - 1;
+	return (i + (key - bounds[i]) / ((double) bounds[i + 1] - bounds[i])) / buckets;
+}
+
+double TableStats::estimate(int lower, int upper) const
+{
+	if (bounds.empty() || lower > upper) return 0;
+
+	// the tuples with lower <= key < upper + 1
+	double fraction = fractionBelow((double) upper + 1) - fractionBelow(lower);
+	return fraction * rowCount;
+}
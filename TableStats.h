@@ -0,0 +1,71 @@
+#ifndef TABLESTATS_H
+#define TABLESTATS_H
+
+#include "Bruinbase.h"
+#include "PageFile.h"
+#include <string>
+#include <vector>
+
+/**
+ * Statistics of a table collected by ANALYZE, used by select() to choose
+ * between a heap scan and an index scan. They are saved in a single page
+ * of <table>.stat:
+ * the # tuples and # pages of the table, an equi-depth histogram of the
+ * key column, and for a table with a BTreeIndex, the # leaf nodes and
+ * the # table pages a full index scan reads (how well the table is
+ * clustered on key).
+ */
+class TableStats {
+ public:
+  // # buckets of the key histogram. each bucket holds about the same # tuples
+  static const int HISTOGRAM_BUCKETS = 64;
+
+  TableStats();
+
+  /**
+   * Collect the statistics by scanning <table>.tbl and <table>.idx.
+   * @param table[IN] the table name
+   * @return error code. 0 if no error
+   */
+  RC compute(const std::string& table);
+
+  /**
+   * Read the statistics from <table>.stat.
+   * @param table[IN] the table name
+   * @return error code. 0 if no error (RC_FILE_OPEN_FAILED if the table
+   *         has not been analyzed)
+   */
+  RC read(const std::string& table);
+
+  /**
+   * Save the statistics to <table>.stat.
+   * @param table[IN] the table name
+   * @return error code. 0 if no error
+   */
+  RC write(const std::string& table);
+
+  /**
+   * Estimate the # tuples with lower <= key <= upper from the histogram.
+   * @param lower[IN] the smallest key of the range
+   * @param upper[IN] the largest key of the range
+   * @return the estimated # tuples
+   */
+  double estimate(int lower, int upper) const;
+
+  int getRowCount() const { return rowCount; }
+  int getPageCount() const { return pageCount; }
+  int getLeafCount() const { return leafCount; }
+  int getFetchCount() const { return fetchCount; }
+
+ private:
+  int rowCount;    /// # tuples in the table
+  int pageCount;   /// # pages in the table
+  int leafCount;   /// # leaf nodes of the BTreeIndex. 0 without an index
+  int fetchCount;  /// # times a full index scan moves to another table page
+  std::vector<int> bounds;  /// bucket i holds the keys in [bounds[i], bounds[i+1]].
+                            /// empty for an empty table
+
+  double fractionBelow(double key) const;
+};
+
+#endif /* TABLESTATS_H */
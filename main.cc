@@ -1,20 +1,20 @@
-/**
- * Copyright (C) 2008 by The Regents of the University of California
- * Redistribution of this file is permitted under the terms of the GNU
- * Public License (GPL).
- *
- * @author Junghoo "John" Cho <cho AT cs.ucla.edu>
- * @date 3/24/2008
- */
- 
-#include "Bruinbase.h"
-#include "SqlEngine.h"
-#include <cstdio>
-
-int main()
-{
-  // run the SQL engine taking user commands from standard input (console).
-  SqlEngine::run(stdin);
-
-  return 0;
-}
+/**
+ * Copyright (C) 2008 by The Regents of the University of California
+ * Redistribution of this file is permitted under the terms of the GNU
+ * Public License (GPL).
+ *
+ * @author Junghoo "John" Cho <cho AT cs.ucla.edu>
+ * @date 3/24/2008
+ */
+ 
+#include "Bruinbase.h"
+#include "SqlEngine.h"
+#include <cstdio>
+
+int main()
+{
+  // run the SQL engine taking user commands from standard input (console).
+  SqlEngine::run(stdin);
+
+  return 0;
+}